@@ -0,0 +1 @@
+../src/util/myFileMap.h
\ No newline at end of file
@@ -4,33 +4,40 @@ cirCmd.o: cirCmd.cpp cirMgr.h cirDef.h ../../include/myHashMap.h \
   ../../include/VarOrder.h ../../include/Heap.h ../../include/Proof.h \
   ../../include/File.h cirCmd.h ../../include/cmdParser.h \
   ../../include/cmdCharDef.h ../../include/util.h ../../include/rnGen.h \
-  ../../include/myUsage.h
+  ../../include/myUsage.h ../../include/myArena.h
 cirFraig.o: cirFraig.cpp cirMgr.h cirDef.h ../../include/myHashMap.h \
   cirGate.h ../../include/sat.h ../../include/Solver.h \
   ../../include/SolverTypes.h ../../include/Global.h \
   ../../include/VarOrder.h ../../include/Heap.h ../../include/Proof.h \
   ../../include/File.h ../../include/util.h ../../include/rnGen.h \
-  ../../include/myUsage.h
+  ../../include/myUsage.h ../../include/myArena.h
 cirGate.o: cirGate.cpp cirGate.h cirDef.h ../../include/myHashMap.h \
   ../../include/sat.h ../../include/Solver.h ../../include/SolverTypes.h \
   ../../include/Global.h ../../include/VarOrder.h ../../include/Heap.h \
   ../../include/Proof.h ../../include/File.h cirMgr.h \
-  ../../include/util.h ../../include/rnGen.h ../../include/myUsage.h
+  ../../include/util.h ../../include/rnGen.h ../../include/myUsage.h \
+  ../../include/myArena.h
 cirMgr.o: cirMgr.cpp cirMgr.h cirDef.h ../../include/myHashMap.h \
   cirGate.h ../../include/sat.h ../../include/Solver.h \
   ../../include/SolverTypes.h ../../include/Global.h \
   ../../include/VarOrder.h ../../include/Heap.h ../../include/Proof.h \
   ../../include/File.h ../../include/util.h ../../include/rnGen.h \
-  ../../include/myUsage.h
+  ../../include/myUsage.h ../../include/myArena.h ../../include/myFileMap.h
 cirOpt.o: cirOpt.cpp cirMgr.h cirDef.h ../../include/myHashMap.h \
   cirGate.h ../../include/sat.h ../../include/Solver.h \
   ../../include/SolverTypes.h ../../include/Global.h \
   ../../include/VarOrder.h ../../include/Heap.h ../../include/Proof.h \
   ../../include/File.h ../../include/util.h ../../include/rnGen.h \
-  ../../include/myUsage.h
+  ../../include/myUsage.h ../../include/myArena.h
+cirSave.o: cirSave.cpp cirMgr.h cirDef.h ../../include/myHashMap.h \
+  cirGate.h ../../include/sat.h ../../include/Solver.h \
+  ../../include/SolverTypes.h ../../include/Global.h \
+  ../../include/VarOrder.h ../../include/Heap.h ../../include/Proof.h \
+  ../../include/File.h ../../include/util.h ../../include/rnGen.h \
+  ../../include/myUsage.h ../../include/myArena.h ../../include/myFileMap.h
 cirSim.o: cirSim.cpp cirMgr.h cirDef.h ../../include/myHashMap.h \
   cirGate.h ../../include/sat.h ../../include/Solver.h \
   ../../include/SolverTypes.h ../../include/Global.h \
   ../../include/VarOrder.h ../../include/Heap.h ../../include/Proof.h \
   ../../include/File.h ../../include/util.h ../../include/rnGen.h \
-  ../../include/myUsage.h
+  ../../include/myUsage.h ../../include/myArena.h ../../include/myFileMap.h
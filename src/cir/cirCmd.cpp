@@ -9,6 +9,7 @@
 #include <cassert>
 #include <iostream>
 #include <iomanip>
+#include <cstdlib>
 #include "cirMgr.h"
 #include "cirGate.h"
 #include "cirCmd.h"
@@ -30,7 +31,9 @@ initCirCmd()
          cmdMgr->regCmd("CIRSTRash", 6, new CirStrashCmd) &&
          cmdMgr->regCmd("CIRSIMulate", 6, new CirSimCmd) &&
          cmdMgr->regCmd("CIRFraig", 4, new CirFraigCmd) &&
-         cmdMgr->regCmd("CIRWrite", 4, new CirWriteCmd)
+         cmdMgr->regCmd("CIRWrite", 4, new CirWriteCmd) &&
+         cmdMgr->regCmd("CIRSAve", 5, new CirSaveCmd) &&
+         cmdMgr->regCmd("CIRLoad", 4, new CirLoadCmd)
       )) {
       cerr << "Registering \"cir\" commands fails... exiting" << endl;
       return false;
@@ -54,7 +57,7 @@ enum CirCmdState
 static CirCmdState curCmd = CIRINIT;
 
 //----------------------------------------------------------------------
-//    CIRRead <(string fileName)> [-Replace]
+//    CIRRead <(string fileName)> [-Replace] [-Threads (int n)] [-Profile]
 //----------------------------------------------------------------------
 CmdExecStatus
 CirReadCmd::exec(const string& option)
@@ -66,13 +69,25 @@ CirReadCmd::exec(const string& option)
    if (options.empty())
       return CmdExec::errorOption(CMD_OPT_MISSING, "");
 
-   bool doReplace = false;
+   bool doReplace = false, doProfile = false;
+   int nThreads = 0;
    string fileName;
    for (size_t i = 0, n = options.size(); i < n; ++i) {
       if (myStrNCmp("-Replace", options[i], 2) == 0) {
          if (doReplace) return CmdExec::errorOption(CMD_OPT_EXTRA,options[i]);
          doReplace = true;
       }
+      else if (myStrNCmp("-Profile", options[i], 2) == 0) {
+         if (doProfile) return CmdExec::errorOption(CMD_OPT_EXTRA,options[i]);
+         doProfile = true;
+      }
+      else if (myStrNCmp("-Threads", options[i], 2) == 0) {
+         if (nThreads) return CmdExec::errorOption(CMD_OPT_EXTRA,options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         if (!myStr2Int(options[i], nThreads) || nThreads <= 0)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+      }
       else {
          if (fileName.size())
             return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
@@ -93,13 +108,15 @@ CirReadCmd::exec(const string& option)
    }
    cirMgr = new CirMgr;
 
-   if (!cirMgr->readCircuit(fileName)) {
+   if (!cirMgr->readCircuit(fileName, nThreads)) {
       curCmd = CIRINIT;
       delete cirMgr; cirMgr = 0;
       return CMD_EXEC_ERROR;
    }
 
    curCmd = CIRREAD;
+   if (doProfile)
+      cirMgr->printParseStats();
 
    return CMD_EXEC_DONE;
 }
@@ -107,7 +124,8 @@ CirReadCmd::exec(const string& option)
 void
 CirReadCmd::usage(ostream& os) const
 {
-   os << "Usage: CIRRead <(string fileName)> [-Replace]" << endl;
+   os << "Usage: CIRRead <(string fileName)> [-Replace] [-Threads (int n)]"
+      << " [-Profile]" << endl;
 }
 
 void
@@ -118,7 +136,8 @@ CirReadCmd::help() const
 }
 
 //----------------------------------------------------------------------
-//    CIRPrint [-Summary | -Netlist | -PI | -PO | -FLoating | -FECpairs]
+//    CIRPrint [-Summary | -Netlist | -PI | -PO | -FLoating | -FECpairs
+//              | -Levels]
 //----------------------------------------------------------------------
 CmdExecStatus
 CirPrintCmd::exec(const string& option)
@@ -144,6 +163,8 @@ CirPrintCmd::exec(const string& option)
       cirMgr->printFloatGates();
    else if (myStrNCmp("-FECpairs", token, 4) == 0)
       cirMgr->printFECPairs();
+   else if (myStrNCmp("-Levels", token, 2) == 0)
+      cirMgr->printLevels();
    else
       return CmdExec::errorOption(CMD_OPT_ILLEGAL, token);
 
@@ -154,7 +175,7 @@ void
 CirPrintCmd::usage(ostream& os) const
 {  
    os << "Usage: CIRPrint [-Summary | -Netlist | -PI | -PO | -FLoating "
-      << "| -FECpairs]" << endl;
+      << "| -FECpairs | -Levels]" << endl;
 }
 
 void
@@ -374,8 +395,11 @@ CirStrashCmd::help() const
 }
 
 //----------------------------------------------------------------------
-//    CIRSIMulate <-Random | -File <string patternFile>>
-//                [-Output (string logFile)]
+//    CIRSIMulate <-Random [-Seed (int s)] [-Gain (int pairsPerSec)]
+//                | -File <string patternFile>>
+//                [-Threads (int n) [-Levels]]
+//                [-Output (string logFile) [-Binary]]
+//                [-Pack (string packedFile)]
 //----------------------------------------------------------------------
 CmdExecStatus
 CirSimCmd::exec(const string& option)
@@ -389,8 +413,11 @@ CirSimCmd::exec(const string& option)
    CmdExec::lexOptions(option, options);
 
    ifstream patternFile;
-   ofstream logFile;
-   bool doRandom = false, doFile = false, doLog = false;
+   ofstream logFile, packFile;
+   string patternName, logName, packName;
+   bool doRandom = false, doFile = false, doLog = false, doPack = false;
+   bool doBinary = false, byLevels = false, doSeed = false;
+   int nThreads = 0, seed = 0, minGain = -1;
    for (size_t i = 0, n = options.size(); i < n; ++i) {
       if (myStrNCmp("-Random", options[i], 2) == 0) {
          if (doRandom || doFile)
@@ -405,6 +432,7 @@ CirSimCmd::exec(const string& option)
          patternFile.open(options[i].c_str(), ios::in);
          if (!patternFile)
             return CmdExec::errorOption(CMD_OPT_FOPEN_FAIL, options[i]);
+         patternName = options[i];
          doFile = true;
       }
       else if (myStrNCmp("-Output", options[i], 2) == 0) {
@@ -412,28 +440,93 @@ CirSimCmd::exec(const string& option)
             return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
          if (++i == n)
             return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
-         logFile.open(options[i].c_str(), ios::out);
-         if (!logFile)
-            return CmdExec::errorOption(CMD_OPT_FOPEN_FAIL, options[i]);
+         logName = options[i];
          doLog = true;
       }
+      else if (myStrNCmp("-Binary", options[i], 2) == 0) {
+         if (doBinary)
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         doBinary = true;
+      }
+      else if (myStrNCmp("-Pack", options[i], 2) == 0) {
+         if (doPack)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         packName = options[i];
+         doPack = true;
+      }
+      else if (myStrNCmp("-Threads", options[i], 2) == 0) {
+         if (nThreads) return CmdExec::errorOption(CMD_OPT_EXTRA,options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         if (!myStr2Int(options[i], nThreads) || nThreads <= 0)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+      }
+      else if (myStrNCmp("-Seed", options[i], 2) == 0) {
+         if (doSeed) return CmdExec::errorOption(CMD_OPT_EXTRA,options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         if (!myStr2Int(options[i], seed) || seed < 0)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+         doSeed = true;
+      }
+      else if (myStrNCmp("-Gain", options[i], 2) == 0) {
+         if (minGain > 0) return CmdExec::errorOption(CMD_OPT_EXTRA,options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         // a gain of 0 would never be undercut
+         if (!myStr2Int(options[i], minGain) || minGain <= 0)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+      }
+      else if (myStrNCmp("-Levels", options[i], 2) == 0) {
+         if (byLevels)
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         byLevels = true;
+      }
       else
          return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
    }
 
    if (!doRandom && !doFile)
       return CmdExec::errorOption(CMD_OPT_MISSING, "");
+   // only file patterns can be converted to the packed format
+   if (doPack && !doFile)
+      return CmdExec::errorOption(CMD_OPT_ILLEGAL, "-Pack");
+   if (doSeed && !doRandom)
+      return CmdExec::errorOption(CMD_OPT_ILLEGAL, "-Seed");
+   if (minGain > 0 && !doRandom)
+      return CmdExec::errorOption(CMD_OPT_ILLEGAL, "-Gain");
+   if (byLevels && !nThreads)
+      return CmdExec::errorOption(CMD_OPT_MISSING, "-Threads");
+   // file patterns are read in order, so only the levels can be split
+   if (nThreads && doFile && !byLevels)
+      return CmdExec::errorOption(CMD_OPT_MISSING, "-Levels");
+   if (doBinary && !doLog)
+      return CmdExec::errorOption(CMD_OPT_MISSING, "-Output");
+   if (doLog) {
+      logFile.open(logName.c_str(), doBinary ? ios::out | ios::binary : ios::out);
+      if (!logFile)
+         return CmdExec::errorOption(CMD_OPT_FOPEN_FAIL, logName);
+   }
+   if (doPack) {
+      packFile.open(packName.c_str(), ios::out | ios::binary);
+      if (!packFile)
+         return CmdExec::errorOption(CMD_OPT_FOPEN_FAIL, packName);
+   }
 
    assert (curCmd != CIRINIT);
    if (doLog)
-      cirMgr->setSimLog(&logFile);
+      cirMgr->setSimLog(&logFile, doBinary);
    else cirMgr->setSimLog(0);
+   cirMgr->setPatternOut(doPack ? &packFile : 0);
 
    if (doRandom)
-      cirMgr->randomSim();
+      cirMgr->randomSim(doSeed ? seed : rand(), nThreads ? nThreads : 1, byLevels, minGain);
    else
-      cirMgr->fileSim(patternFile);
+      cirMgr->fileSim(patternName, nThreads ? nThreads : 1);
    cirMgr->setSimLog(0);
+   cirMgr->setPatternOut(0);
    curCmd = CIRSIMULATE;
    
    return CMD_EXEC_DONE;
@@ -442,8 +535,11 @@ CirSimCmd::exec(const string& option)
 void
 CirSimCmd::usage(ostream& os) const
 {
-   os << "Usage: CIRSIMulate <-Random | -File <string patternFile>>\n"
-      << "                   [-Output (string logFile)]" << endl;
+   os << "Usage: CIRSIMulate <-Random [-Seed (int s)] [-Gain (int pairsPerSec)]\n"
+      << "                   | -File <string patternFile>>\n"
+      << "                   [-Threads (int n) [-Levels]]\n"
+      << "                   [-Output (string logFile) [-Binary]]\n"
+      << "                   [-Pack (string packedFile)]" << endl;
 }
 
 void
@@ -454,7 +550,7 @@ CirSimCmd::help() const
 }
 
 //----------------------------------------------------------------------
-//    CIRFraig
+//    CIRFraig [-Flip (int nNeighbours)]
 //----------------------------------------------------------------------
 CmdExecStatus
 CirFraigCmd::exec(const string& option)
@@ -467,14 +563,26 @@ CirFraigCmd::exec(const string& option)
    vector<string> options;
    CmdExec::lexOptions(option, options);
 
-   if (!options.empty())
-      return CmdExec::errorOption(CMD_OPT_EXTRA, options[0]);
+   int nFlips = 0;
+   bool doFlip = false;
+   for (size_t i = 0, n = options.size(); i < n; ++i) {
+      if (myStrNCmp("-Flip", options[i], 2) == 0) {
+         if (doFlip) return CmdExec::errorOption(CMD_OPT_EXTRA,options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         if (!myStr2Int(options[i], nFlips) || nFlips < 0)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+         doFlip = true;
+      }
+      else
+         return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+   }
 
    if (curCmd != CIRSIMULATE) {
       cerr << "Error: circuit is not yet simulated!!" << endl;
       return CMD_EXEC_ERROR;
    }
-   cirMgr->fraig();
+   cirMgr->fraig(nFlips);
    curCmd = CIRFRAIG;
 
    return CMD_EXEC_DONE;
@@ -483,7 +591,7 @@ CirFraigCmd::exec(const string& option)
 void
 CirFraigCmd::usage(ostream& os) const
 {
-   os << "Usage: CIRFraig" << endl;
+   os << "Usage: CIRFraig [-Flip (int nNeighbours)]" << endl;
 }
 
 void
@@ -494,7 +602,7 @@ CirFraigCmd::help() const
 }
 
 //----------------------------------------------------------------------
-//    CIRWrite [(int gateId)][-Output (string aagFile)]
+//    CIRWrite [(int gateId)][-Output (string aagFile)][-Binary]
 //----------------------------------------------------------------------
 CmdExecStatus
 CirWriteCmd::exec(const string& option)
@@ -511,21 +619,24 @@ CirWriteCmd::exec(const string& option)
       cirMgr->writeAag(cout);
       return CMD_EXEC_DONE;
    }
-   bool hasFile = false;
+   bool hasFile = false, doBinary = false;
    int gateId;
    CirGate *thisGate = NULL;
-   ofstream outfile;
+   string fileName;
    for (size_t i = 0, n = options.size(); i < n; ++i) {
       if (myStrNCmp("-Output", options[i], 2) == 0) {
          if (hasFile) 
             return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
          if (++i == n)
             return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
-         outfile.open(options[i].c_str(), ios::out);
-         if (!outfile)
-            return CmdExec::errorOption(CMD_OPT_FOPEN_FAIL, options[1]);
+         fileName = options[i];
          hasFile = true;
       }
+      else if (myStrNCmp("-Binary", options[i], 2) == 0) {
+         if (doBinary)
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         doBinary = true;
+      }
       else if (myStr2Int(options[i], gateId) && gateId >= 0) {
          if (thisGate != NULL)
             return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
@@ -542,7 +653,21 @@ CirWriteCmd::exec(const string& option)
       else return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
    }
 
-   if (!thisGate) {
+   // binary AIGER is never sent to the terminal
+   if (doBinary && !hasFile)
+      return CmdExec::errorOption(CMD_OPT_MISSING, "-Output");
+   ofstream outfile;
+   if (hasFile) {
+      outfile.open(fileName.c_str(), doBinary ? ios::out | ios::binary : ios::out);
+      if (!outfile)
+         return CmdExec::errorOption(CMD_OPT_FOPEN_FAIL, fileName);
+   }
+
+   if (doBinary) {
+      if (thisGate) cirMgr->writeAig(outfile, thisGate);
+      else cirMgr->writeAig(outfile);
+   }
+   else if (!thisGate) {
       assert (hasFile);
       cirMgr->writeAag(outfile);
    }
@@ -555,13 +680,112 @@ CirWriteCmd::exec(const string& option)
 void
 CirWriteCmd::usage(ostream& os) const
 {
-   os << "Usage: CIRWrite [(int gateId)][-Output (string aagFile)]" << endl;
+   os << "Usage: CIRWrite [(int gateId)][-Output (string aagFile)][-Binary]"
+      << endl;
 }
 
 void
 CirWriteCmd::help() const
 {
    cout << setw(15) << left << "CIRWrite: "
-        << "write the netlist to an ASCII AIG file (.aag)\n";
+        << "write the netlist to an AIG file (.aag or binary .aig)\n";
 }
 
+//----------------------------------------------------------------------
+//    CIRSAve <(string imageFile)>
+//----------------------------------------------------------------------
+CmdExecStatus
+CirSaveCmd::exec(const string& option)
+{
+   if (!cirMgr) {
+      cerr << "Error: circuit is not yet constructed!!" << endl;
+      return CMD_EXEC_ERROR;
+   }
+   // check option
+   string token;
+   if (!CmdExec::lexSingleOption(option, token, false))
+      return CMD_EXEC_ERROR;
+
+   if (!cirMgr->saveImage(token, curCmd))
+      return CmdExec::errorOption(CMD_OPT_FOPEN_FAIL, token);
+
+   return CMD_EXEC_DONE;
+}
+
+void
+CirSaveCmd::usage(ostream& os) const
+{
+   os << "Usage: CIRSAve <(string imageFile)>" << endl;
+}
+
+void
+CirSaveCmd::help() const
+{
+   cout << setw(15) << left << "CIRSAve: "
+        << "save the circuit and its simulation state to an image\n";
+}
+
+//----------------------------------------------------------------------
+//    CIRLoad <(string imageFile)> [-Replace]
+//----------------------------------------------------------------------
+CmdExecStatus
+CirLoadCmd::exec(const string& option)
+{
+   // check option
+   vector<string> options;
+   if (!CmdExec::lexOptions(option, options))
+      return CMD_EXEC_ERROR;
+   if (options.empty())
+      return CmdExec::errorOption(CMD_OPT_MISSING, "");
+
+   bool doReplace = false;
+   string fileName;
+   for (size_t i = 0, n = options.size(); i < n; ++i) {
+      if (myStrNCmp("-Replace", options[i], 2) == 0) {
+         if (doReplace) return CmdExec::errorOption(CMD_OPT_EXTRA,options[i]);
+         doReplace = true;
+      }
+      else {
+         if (fileName.size())
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+         fileName = options[i];
+      }
+   }
+
+   if (cirMgr != 0) {
+      if (doReplace) {
+         cerr << "Note: original circuit is replaced..." << endl;
+         curCmd = CIRINIT;
+         delete cirMgr; cirMgr = 0;
+      }
+      else {
+         cerr << "Error: circuit already exists!!" << endl;
+         return CMD_EXEC_ERROR;
+      }
+   }
+   cirMgr = new CirMgr;
+
+   unsigned state;
+   if (!cirMgr->loadImage(fileName, state) || state <= CIRINIT ||
+       state >= CIRCMDTOT) {
+      curCmd = CIRINIT;
+      delete cirMgr; cirMgr = 0;
+      return CMD_EXEC_ERROR;
+   }
+   curCmd = CirCmdState(state);
+
+   return CMD_EXEC_DONE;
+}
+
+void
+CirLoadCmd::usage(ostream& os) const
+{
+   os << "Usage: CIRLoad <(string imageFile)> [-Replace]" << endl;
+}
+
+void
+CirLoadCmd::help() const
+{
+   cout << setw(15) << left << "CIRLoad: "
+        << "restore a circuit saved by CIRSAve\n";
+}
@@ -16,6 +16,34 @@ using namespace std;
 
 // TODO: define your own typedef or enum
 
+enum GateType
+{
+   UNDEF_GATE = 0,
+   PI_GATE    = 1,
+   PO_GATE    = 2,
+   AIG_GATE   = 3,
+   CONST_GATE = 4,
+
+   TOT_GATE
+};
+
+// Edges are AIGER literals: fanin ID * 2 + 1 if complemented
+inline unsigned toLit(unsigned id, bool inv) { return (id << 1) | unsigned(inv); }
+inline unsigned litID(unsigned lit) { return lit >> 1; }
+inline bool litInv(unsigned lit) { return lit & 1; }
+
+// 64 simulation patterns at once; bit k belongs to the k-th pattern
+typedef unsigned long long SimWord;
+
+// A simulation pass takes 64 * simWords patterns. A gate's values fill one
+// 64-byte SimBlock, which the SIMD kernels load and store whole; word j
+// holds patterns 64j to 64j + 63.
+const size_t simWords = 8;
+struct alignas(64) SimBlock
+{
+    SimWord w[simWords];
+};
+
 class CirGate;
 class CirMgr;
 class SatSolver;
@@ -29,16 +29,13 @@ using namespace std;
 /*   Static varaibles and functions   */
 /**************************************/
 
-unsigned
-hashKey(CirGate* gate, unsigned k)
+// the fanin literal pair, smaller one first
+static unsigned long long
+hashKey(unsigned fanin0, unsigned fanin1)
 {
-    unsigned fanin0 = gate->_fanin0 * 2;
-    if(gate->_invPhase0) fanin0++;
-    unsigned fanin1 = gate->_fanin1 * 2;
-    if(gate->_invPhase1) fanin1++;
     unsigned a = (fanin0 < fanin1 ? fanin0 : fanin1);
     unsigned b = (fanin0 < fanin1 ? fanin1 : fanin0);
-    return (k * (a - 1) - (a * (a - 1)) / 2 + (b - a));
+    return ((unsigned long long)a << 32) | b;
 }
 
 /*******************************************/
@@ -49,104 +46,89 @@ hashKey(CirGate* gate, unsigned k)
 void
 CirMgr::strash()
 {
-    unsigned k = (M + O + 3) * 2;
-    unordered_map<unsigned, CirGate*> m;
-    for(size_t i = 0; i < _dfsList.size(); ++i)
+    unordered_map<unsigned long long, CirGate*> m;
+    for(size_t i = 0; i < _topoOrder.size(); ++i)
     {
-        if(_dfsList[i]->getTypeStr() != "AIG") continue;
-        if(m[hashKey(_dfsList[i], k)])
+        unsigned id = _topoOrder[i];
+        if(_gateType[id] != AIG_GATE) continue;
+        CirGate*& mgate = m[hashKey(_fanin0Lit[id], _fanin1Lit[id])];
+        if(mgate)
         {
-            merge(m[hashKey(_dfsList[i], k)], _dfsList[i]);
-            cout << "Strashing: " << m[hashKey(_dfsList[i], k)]->_gateID
-            << " merging " << _dfsList[i]->_gateID << "...\n";
+            merge(mgate, _gateList[id]);
+            cout << "Strashing: " << mgate->_gateID
+            << " merging " << id << "...\n";
         }
         else
-            m[hashKey(_dfsList[i], k)] = _dfsList[i];
+            mgate = _gateList[id];
     }
     
-    genDFSList();
-    sort(_floting.begin(), _floting.end());
-    sort(_unused.begin(), _unused.end());
+    updateGateLists(true);
+    updateDFSList();
 }
 
+// Each SAT model (with nFlips neighbours, one PI flipped in each) goes to
+// a 64-pattern buffer; a full buffer is simulated at once and refines the
+// FEC classes before the next SAT call, so one model can split many
+// classes. The leading gate of each new class is its first gate in DFS
+// order already visited, if any.
 void
-CirMgr::fraig()
+CirMgr::fraig(unsigned nFlips)
 {
     SatSolver solver;
     solver.initialize();
     
 //    initCircuit();
     genProofModel(solver);
+    _cexWords.assign(I, 0);
+    _cexCnt = _cexFlip = 0;
    
-    unordered_map<vector<unsigned>*, CirGate*> leadingGate;
-    size_t n = fecPairs.size();
+    vector<CirGate*> leadingGate(_fecClasses.size(), 0);     // by class
+    // after flushCex(): lead the new classes by their first gate before "end"
+    auto findLeaders = [&](size_t end) {
+        leadingGate.assign(_fecClasses.size(), 0);
+        for(unsigned c = 0; c < _fecClasses.size(); ++c)
+            for(size_t j = 0; j < _fecClasses.classSize(c); ++j)
+            {
+                unsigned id = _fecClasses.members(c)[j] / 2;
+                if(!inDFSList(id) || _dfsPos[id] >= end) continue;
+                CirGate*& lead = leadingGate[c];
+                if(!lead || _dfsPos[lead->_gateID] > _dfsPos[id]) lead = getGate(id);
+            }
+    };
     CirGate* gate;
-    vector<unsigned>* v;
-    string SATpattern;
     size_t gateMerged = 0;
     for(size_t i = 0; i < _dfsList.size(); ++i)
     {
         gate = _dfsList[i];
-        if(gate->getTypeStr() == "PO") continue;
-        if(!gate->_fecGroup) continue;
-        if(!leadingGate[gate->_fecGroup]) leadingGate[gate->_fecGroup] = gate;
+        if(!gate || _gateType[gate->_gateID] == PO_GATE) continue;
+        unsigned c = _fecClasses.classOf(gate->_gateID);
+        if(c == noID) continue;
+        if(!leadingGate[c]) leadingGate[c] = gate;
         else
         {
             Var newV = solver.newVar();
-            int a, b;
-            for(size_t j = 0; j < gate->_fecGroup->size(); ++j)
-            {
-                if((*gate->_fecGroup)[j] / 2 == leadingGate[gate->_fecGroup]->_gateID)
-                {
-                    a = (*gate->_fecGroup)[j];
-                }
-                if((*gate->_fecGroup)[j] / 2 == gate->_gateID)
-                {
-                    b = (*gate->_fecGroup)[j];
-                    (*gate->_fecGroup)[j] = (*gate->_fecGroup)[0];
-                    gate->_fecGroup->erase(gate->_fecGroup->begin());
-                    j--;
-//                    cout << "ID:" << gate->_gateID << endl;
-//                    for(size_t k = 0; k < gate->_fecGroup->size(); ++k)
-//                        cout << (*gate->_fecGroup)[k] << " ";
-//                    cout << endl << endl;
-                }
-            }
+            int a = _fecClasses.litOf(leadingGate[c]->_gateID);
+            int b = _fecClasses.litOf(gate->_gateID);
+            _fecClasses.remove(c, gate->_gateID);
             bool inv = (abs(b - a) % 2 == 1);
-            solver.addXorCNF(newV, leadingGate[gate->_fecGroup]->getVar(), false, gate->getVar(), inv);
+            solver.addXorCNF(newV, _satVar[leadingGate[c]->_gateID], false, _satVar[gate->_gateID], inv);
             solver.assumeRelease();
             solver.assumeProperty(newV, true);
             bool result = solver.assumpSolve();
-//            cerr << leadingGate[gate->_fecGroup]->_gateID << " " << gate->_gateID << " " << inv << " " << result << endl;
+//            cerr << leadingGate[c]->_gateID << " " << gate->_gateID << " " << inv << " " << result << endl;
             if(!result) // UNSAT
             {gateMerged++;
-                merge(leadingGate[gate->_fecGroup], gate);
-                cout << "Fraig: " << leadingGate[gate->_fecGroup]->_gateID << " merging " << (inv? "!" : "") << gate->_gateID << "...\n";
-            }
-            else
-            {
-                // ?
-                SATpattern = "";
-                for(size_t i = 0; i < I; ++i)
-                {
-                    if(solver.getValue(_piList[i]->getVar()))
-                        SATpattern += "1";
-                    else SATpattern += "0";
-//                    cout << solver.getValue(_piList[i]->getVar()) << " ";
-                }
-//                cout << solver.getValue(const0->getVar());
-//                cout << endl;
-                SATpatterns.push_back(SATpattern);
+                merge(leadingGate[c], gate);
+                cout << "Fraig: " << leadingGate[c]->_gateID << " merging " << (inv? "!" : "") << gate->_gateID << "...\n";
             }
+            else if(addCex(solver, nFlips)) findLeaders(i + 1);
         }
     }
     
-    genDFSList();
-    sort(_floting.begin(), _floting.end());
-    sort(_unused.begin(), _unused.end());
+    updateGateLists(true);
+    updateDFSList();
 //    cout << "gate merged: " << gateMerged << endl;
-    while(fecPairs.size())
-        fecPairs.pop();
+    _fecClasses.clear();
 }
 
 /********************************************/
@@ -159,57 +141,83 @@ CirMgr::merge(CirGate* mgate, CirGate* gate)
     unsigned mgid = mgate->_gateID;
     unsigned gid  = gate->_gateID;
     
-    CirGate* fanin = getGate(gate->_fanin0);
-    for(vector<unsigned>::iterator it = fanin->_fanout.begin();
-        it != fanin->_fanout.end(); ++it)
-    {
-        if(*it == gid)
-        {
-            fanin->_fanout.erase(it);
-            break;
-        }
-    }
-    fanin = getGate(gate->_fanin1);
-    for(vector<unsigned>::iterator it = fanin->_fanout.begin();
-        it != fanin->_fanout.end(); ++it)
-    {
-        if(*it == gid)
-        {
-            fanin->_fanout.erase(it);
-            break;
-        }
-    }
+    removeFanout(gate->getFanin(0), gid);
+    removeFanout(gate->getFanin(1), gid);
     
+    // setFanin() updates the arrays too, as strash hashes these fanouts next
     CirGate* fanouts;
-    for(size_t i = 0; i < gate->_fanout.size(); ++i)
+    vector<unsigned> moved;
+    for(size_t i = 0; i < getFanoutNum(gid); ++i)
     {
-        fanouts = getGate(gate->_fanout[i]);
-        if(fanouts->_fanin0 == gid)
-            fanouts->_fanin0 = mgid;
-        else
-            fanouts->_fanin1 = mgid;
-        mgate->_fanout.push_back(gate->_fanout[i]);
+        unsigned fo = getFanout(gid, i);
+        fanouts = getGate(fo);
+        size_t k = (fanouts->getFanin(0) == gid ? 0 : 1);
+        setFanin(fanouts, k, toLit(mgid, fanouts->isFaninInv(k)));
+        addFanout(mgid, fo);
+        moved.push_back(fo);
     }
+    dropFromDFSList(gate, mgid);
+    resimulate(_simVal, moved);     // keep the signatures without a full pass
     
-    for(vector<CirGate*>::iterator it = _aigList.begin();
-        it != _aigList.end(); ++it)
+    dropFromAigList(gate);
+    _floting.erase(gid);
+}
+
+// Add the solver's model to the buffer, then nFlips of its neighbours,
+// taking the PIs to flip in turn; true if the buffer filled up and was
+// simulated. The PI values are read from the model into each lane. The
+// model itself is also kept in _satWords for the next random simulation.
+bool
+CirMgr::addCex(const SatSolver& solver, unsigned nFlips)
+{
+    bool flushed = false;
+    for(unsigned k = 0; k <= nFlips && (k == 0 || I); ++k)
     {
-        if(*it == gate)
+        SimWord bit = SimWord(1) << _cexCnt;
+        for(size_t i = 0; i < I; ++i)
+            if(solver.getValue(_satVar[_piList[i]->_gateID])) _cexWords[i] |= bit;
+        if(k)
         {
-            _aigList.erase(it);
-            break;
+            _cexWords[_cexFlip] ^= bit;
+            _cexFlip = (_cexFlip + 1) % I;
         }
-    }
-    
-    for(vector<unsigned>::iterator it = _floting.begin();
-        it != _floting.end(); ++it)
-    {
-        if(*it == gid)
+        else if(I)
+        {
+            if(_satCnt % 64 == 0) _satWords.resize(_satWords.size() + I, 0);
+            SimWord* s = &_satWords[_satCnt / 64 * I];
+            for(size_t i = 0; i < I; ++i)
+                s[i] |= ((_cexWords[i] >> _cexCnt) & 1) << (_satCnt % 64);
+            ++_satCnt;
+        }
+        if(++_cexCnt == 64)
         {
-            _floting.erase(it);
-            break;
+            flushCex();
+            flushed = true;
         }
     }
+    return flushed;
+}
+
+// Simulate the buffer on _simVal (word 0) and refine the FEC classes. The
+// unused lanes repeat the models, so that no made-up pattern splits a
+// class. The PIs' fanout cones are resimulated by events, as the level
+// order is stale in the middle of the merges.
+void
+CirMgr::flushCex()
+{
+    if(!_cexCnt) return;
+    vector<unsigned> pis(I);
+    for(size_t i = 0; i < I; ++i)
+    {
+        for(size_t b = _cexCnt; b < 64; ++b)
+            _cexWords[i] |= ((_cexWords[i] >> (b % _cexCnt)) & 1) << b;
+        pis[i] = _piList[i]->_gateID;
+        _simVal[pis[i]].w[0] = _cexWords[i];
+    }
+    resimulate(_simVal, pis);
+    genFECPairs(_simVal, 0, ~SimWord(0));
+    fill(_cexWords.begin(), _cexWords.end(), 0);
+    _cexCnt = 0;
 }
 
 //void
@@ -218,27 +226,29 @@ CirMgr::merge(CirGate* mgate, CirGate* gate)
 //
 //}
 
+// UNDEF fanins and PIs outside the DFS become free variables, so addCex
+// can read every PI from the model
 void
 CirMgr::genProofModel(SatSolver& s)
 {
-    for(size_t i = 0; i < _dfsList.size(); ++i)
-    {
-        Var v = s.newVar();
-        _dfsList[i]->setVar(v);
-    }
-    
-    for(size_t i = 0; i < _dfsList.size(); ++i)
-    {
-        if(_dfsList[i]->getTypeStr() != "AIG") continue;
-        
-        s.addAigCNF(_dfsList[i]->getVar(), _dfsList[i]->_f0ptr->getVar(), _dfsList[i]->_invPhase0, _dfsList[i]->_f1ptr->getVar(), _dfsList[i]->_invPhase1);
-    }
+    _satVar.assign(_gateList.size(), -1);
+    for(size_t i = 0; i < _topoOrder.size(); ++i)
+        _satVar[_topoOrder[i]] = s.newVar();
+    if(_satVar[0] == -1)
+        _satVar[0] = s.newVar();
+    for(size_t i = 0; i < I; ++i)
+        if(_satVar[_piList[i]->_gateID] == -1)
+            _satVar[_piList[i]->_gateID] = s.newVar();
     
-    if(const0->getVar() == -1)
+    for(size_t i = 0; i < _topoOrder.size(); ++i)
     {
-        Var v = s.newVar();
-        const0->setVar(v);
+        unsigned id = _topoOrder[i];
+        if(_gateType[id] != AIG_GATE) continue;
+        unsigned l0 = _fanin0Lit[id], l1 = _fanin1Lit[id];
+        if(_satVar[litID(l0)] == -1) _satVar[litID(l0)] = s.newVar();
+        if(_satVar[litID(l1)] == -1) _satVar[litID(l1)] = s.newVar();
+        s.addAigCNF(_satVar[id], _satVar[litID(l0)], litInv(l0), _satVar[litID(l1)], litInv(l1));
     }
     
-    s.addAigCNF(const0->getVar(), const0->getVar(), true, const0->getVar(), false);
+    s.addAigCNF(_satVar[0], _satVar[0], true, _satVar[0], false);
 }
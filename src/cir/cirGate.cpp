@@ -34,37 +34,32 @@ CirGate::reportGate() const
     unsigned line = _lineNo + 1;
     if(_gateID == 0) line--;
     string str = getTypeStr() + "(" + to_string(_gateID) + ")";
-    if(_symbol.size()) str += ("\"" + _symbol + "\"");
+    if(getSymbol().size()) str += ("\"" + getSymbol() + "\"");
     str += ", line " + to_string(line);
     cout << "================================================================================"; // 80
     cout << "= " << left << setw(78) << str << endl;
     cout << "= FECs:";
-    int b = (_invFec ? 0 : 1);
-    int c;
-    if(_fecGroup)
+    CirFecClasses& fec = cirMgr->_fecClasses;
+    unsigned k = fec.classOf(_gateID);
+    if(k != noID)
     {
-        sort(_fecGroup->begin(), _fecGroup->end());
-        for(size_t i = 0; i < _fecGroup->size(); ++i)
+        int b = (fec.litOf(_gateID) % 2 == 1 ? 0 : 1);
+        fec.sortClass(k);
+        const unsigned* v = fec.members(k);
+        for(size_t i = 0; i < fec.classSize(k); ++i)
         {
-            c = (*_fecGroup)[i] / 2;
+            int c = v[i] / 2;
             if(c == _gateID) continue;
-            cout << " " << ((*_fecGroup)[i] % 2 == b ? "!" : "") << c;
+            cout << " " << (v[i] % 2 == b ? "!" : "") << c;
         }
     }
     cout << endl;
     cout << "= Value: ";
-    string v;
-    for(size_t i = 0; i < 7; ++i)
+    for(int i = 63; i >= 0; --i)
     {
-        v = _value.front();
-        _value.pop();
-        cout << v << "_";
-        _value.push(v);
+        cout << ((cirMgr->_value[_gateID] >> i) & 1);
+        if(i && i % 8 == 0) cout << "_";
     }
-    v = _value.front();
-    _value.pop();
-    cout << v;
-    _value.push(v);
     cout << endl;
     cout << "================================================================================\n";
 }
@@ -86,3 +81,21 @@ CirGate::reportFanout(int level) const
 }
 
 unsigned CirGate::_globalRef = 0;
+
+unsigned
+CirGate::getFaninLit(size_t i) const
+{
+    return (i ? cirMgr->_fanin1Lit : cirMgr->_fanin0Lit)[_gateID];
+}
+
+const string&
+CirGate::getSymbol() const
+{
+    return cirMgr->getSymbol(_gateID);
+}
+
+bool
+CirGate::isFaninUndef(size_t i) const
+{
+    return !cirMgr->getDefGate(getFanin(i));
+}
@@ -17,34 +17,43 @@
 #include <iostream>
 #include "cirDef.h"
 #include "sat.h"
+#include "myArena.h"
 
 using namespace std;
 
 // TODO: Feel free to define your own classes, variables, or functions.
 
-static string nonV = "00000000";
-
 class CirGate;
 
 //------------------------------------------------------------------------
 //   Define classes
 //------------------------------------------------------------------------
+// A gate is a thin view for printing and the commands: its fanins, symbol
+// and simulated values live in the arrays of cirMgr, by gate ID.
 class CirGate
 {
     friend class CirMgr;
-    friend unsigned hashKey(CirGate* gate, unsigned k);
 public:
-    CirGate(unsigned gateID, unsigned lineNo): _gateID(gateID), _lineNo(lineNo), _symbol(""), _ref(0), _canBeReached(false), _var(-1)
-    {
-        for(size_t i = 0; i < 8; ++i)
-            _value.push(nonV);
-    }
+    CirGate(unsigned gateID, unsigned lineNo): _ref(0),
+        _gateID(gateID), _lineNo(lineNo), _canBeReached(false) {}
     virtual ~CirGate() {}
+    
+    // Gates are placed in their CirMgr's arena and never deleted one by
+    // one; CirMgr::destroyGate() runs the destructor.
+    static void* operator new(size_t size, MyArena& arena) { return arena.alloc(size); }
 
    // Basic access methods
     virtual string getTypeStr() const = 0;
     unsigned getLineNo() const { return _lineNo + 1; }
     virtual bool isAig() const = 0;         // ?
+    
+    // Fanin i (0 or 1; PO gates have fanin 0 only) as a literal, and its
+    // gate ID and complement bit. CirMgr::setFanin() changes them.
+    unsigned getFaninLit(size_t i) const;
+    unsigned getFanin(size_t i) const { return litID(getFaninLit(i)); }
+    bool isFaninInv(size_t i) const { return litInv(getFaninLit(i)); }
+    bool isFaninUndef(size_t i) const;
+    const string& getSymbol() const;
 
    // Printing functions
     virtual void printGate() const = 0;
@@ -52,42 +61,16 @@ public:
     void reportFanin(int level) const;
     void reportFanout(int level) const;
     
-    void setSymbol(string& str) { _symbol = str; }
-    virtual void DFS(map<unsigned, CirGate*>& _gateList, vector<CirGate*>& _dfsList) = 0;
-    void addFanout(unsigned n) { _fanout.push_back(n); }
-    
-    virtual bool simulateByDFS() = 0;
-    bool                _sim;
     unsigned            _ref;
-    vector<unsigned>*   _fecGroup;
-    bool                _invFec;
-    
-    void setVar(const Var& v) { _var = v; }
-    Var  getVar() const { return _var; }
-    
-    mutable queue<string>   _value;
    
 private:
 
 protected:
     unsigned    _gateID;
     unsigned    _lineNo;
-    unsigned    _fanin0;
-    unsigned    _fanin1;
-    CirGate*    _f0ptr;
-    CirGate*    _f1ptr;
-    bool        _invPhase0;
-    bool        _invPhase1;
-    string      _symbol;
-    
-    vector<unsigned>    _fanout;
     
     static unsigned     _globalRef;
     bool                _canBeReached;
-    
-    size_t      _simResults;
-    
-    Var         _var;
 };
 
 class CirPiGate: public CirGate
@@ -103,156 +86,58 @@ public:
         else
         {
             cout << "PI  " << _gateID;
-            if(_symbol.size()) cout << " (" << _symbol << ")";
+            if(getSymbol().size()) cout << " (" << getSymbol() << ")";
             cout << endl;
         }
     }
-    void DFS(map<unsigned, CirGate*>& _gateList, vector<CirGate*>& _dfsList)
-    {
-        if(_ref == _globalRef) return;
-        _dfsList.push_back(this);
-        _ref = _globalRef;
-        _canBeReached = true;
-    }
-    bool simulateByDFS()
-    {
-//        cout << _gateID << endl;
-//        cout << "PI" << _gateID << ":" << _sim << endl;
-        _ref = _globalRef;
-        return _sim;
-    }
 };
 
 class CirPoGate: public CirGate
 {
 public:
-    CirPoGate(unsigned gateID, unsigned lineNo, unsigned fanin): CirGate(gateID, lineNo)
-    {
-        _fanin0 = fanin / 2;
-        _invPhase0 = (fanin % 2 == 1);
-    }
+    CirPoGate(unsigned gateID, unsigned lineNo): CirGate(gateID, lineNo) {}
     ~CirPoGate() {}
     bool isAig() const { return false; }
     string getTypeStr() const { return "PO"; }
     void printGate() const
     {
         cout << "PO  " << _gateID << " ";
-        if(!_f0ptr) cout << "*";
-        if(_invPhase0) cout << "!";
-        cout << _fanin0;
-        if(_symbol.size()) cout << " (" << _symbol << ")";
+        if(isFaninUndef(0)) cout << "*";
+        if(isFaninInv(0)) cout << "!";
+        cout << getFanin(0);
+        if(getSymbol().size()) cout << " (" << getSymbol() << ")";
         cout << endl;
     }
-    void DFS(map<unsigned, CirGate*>& _gateList, vector<CirGate*>& _dfsList)
-    {
-        if(_ref == _globalRef) return;
-        bool withFloatingFanin = false;
-        if(_gateList[_fanin0])
-        {
-            _gateList[_fanin0]->DFS(_gateList, _dfsList);
-            _f0ptr = _gateList[_fanin0];
-//            cout << _gateID << " " << _f0ptr << endl;
-        }
-        else withFloatingFanin = true;
-        _dfsList.push_back(this);
-        _ref = _globalRef;
-        _canBeReached = true;
-    }
-    bool simulateByDFS()
-    {
-        bool _f0;
-        if(_f0ptr->_ref == _globalRef) _f0 = _f0ptr->_sim;
-        else _f0 = _f0ptr->simulateByDFS();
-        if(_invPhase0) _f0 = !_f0;
-//        cout << "PO" << _gateID << ":" << _f0 << endl;
-        _sim = _f0;
-        _ref = _globalRef;
-        return _f0;
-    }
 };
 
 class CirAigGate: public CirGate
 {
 public:
-    CirAigGate(unsigned gateID, unsigned lineNo, unsigned fanin0, unsigned fanin1): CirGate(gateID, lineNo)
-    {
-        _fanin0 = fanin0 / 2;
-        _fanin1 = fanin1 / 2;
-        _invPhase0 = (fanin0 % 2 == 1);
-        _invPhase1 = (fanin1 % 2 == 1);
-    }
+    CirAigGate(unsigned gateID, unsigned lineNo): CirGate(gateID, lineNo) {}
     ~CirAigGate() {}
     bool isAig() const { return true; }
     string getTypeStr() const { return "AIG"; }
     void printGate() const
     {
         cout << "AIG " << _gateID << " ";
-        if(!_f0ptr) cout << "*";
-        if(_invPhase0) cout << "!";
-        cout << _fanin0 << " ";
-        if(!_f1ptr) cout << "*";
-        if(_invPhase1) cout << "!";
-        cout << _fanin1 << " ";
+        if(isFaninUndef(0)) cout << "*";
+        if(isFaninInv(0)) cout << "!";
+        cout << getFanin(0) << " ";
+        if(isFaninUndef(1)) cout << "*";
+        if(isFaninInv(1)) cout << "!";
+        cout << getFanin(1) << " ";
         cout << endl;
     }
-    void DFS(map<unsigned, CirGate*>& _gateList, vector<CirGate*>& _dfsList)
-    {
-        if(_ref == _globalRef) return;
-        bool withFloatingFanin = false;
-        if(_gateList[_fanin0])
-        {
-            _gateList[_fanin0]->DFS(_gateList, _dfsList);
-            _f0ptr = _gateList[_fanin0];
-//            cout << _gateID << " " << _f0ptr << endl;
-        }
-        else withFloatingFanin = true;
-        if(_gateList[_fanin1])
-        {
-            _gateList[_fanin1]->DFS(_gateList, _dfsList);
-            _f1ptr = _gateList[_fanin1];
-//            cout << _gateID << " " << _f1ptr << endl;
-        }
-        else withFloatingFanin = true;
-        _dfsList.push_back(this);
-        _ref = _globalRef;
-        _canBeReached = true;
-    }
-    bool simulateByDFS()
-    {
-        bool _f0;
-        if(_f0ptr->_ref == _globalRef) _f0 = _f0ptr->_sim;
-        else _f0 = _f0ptr->simulateByDFS();
-        if(_invPhase0) _f0 = !_f0;
-        bool _f1;
-        if(_f1ptr->_ref == _globalRef) _f1 = _f1ptr->_sim;
-        else _f1 = _f1ptr->simulateByDFS();
-        if(_invPhase1) _f1 = !_f1;
-//        cout << _gateID << endl;
-//        cout << "AIG" << _gateID << ":" << _f0 << " " << _f1 << endl;
-        _sim = _f0 & _f1;
-        _ref = _globalRef;
-        return _f0 & _f1;
-    }
 };
 
 class CirUndefGate: public CirGate
 {
 public:
-    CirUndefGate(unsigned gateID, unsigned nofanin): CirGate(gateID, 0)
-    {
-        _fanin0 = _fanin1 = nofanin;
-    }
+    CirUndefGate(unsigned gateID): CirGate(gateID, 0) {}
     ~CirUndefGate() {}
     bool isAig() const { return false; }
     string getTypeStr() const { return "UNDEF"; }
     void printGate() const {}
-    void DFS(map<unsigned, CirGate*>& _gateList, vector<CirGate*>& _dfsList) { /* _canBeReached = true; */ }
-    bool simulateByDFS()
-    {
-        _sim = false;
-        _ref = _globalRef;
-        return false;
-    }
 };
 
 #endif // CIR_GATE_H
@@ -13,9 +13,13 @@
 #include <ctype.h>
 #include <cassert>
 #include <cstring>
+#include <chrono>
+#include <thread>
+#include <functional>
 #include "cirMgr.h"
 #include "cirGate.h"
 #include "util.h"
+#include "myFileMap.h"
 
 using namespace std;
 
@@ -59,6 +63,75 @@ static string errMsg;
 static int errInt;
 static CirGate *errGate;
 
+// Cursor into the memory-mapped design file; the readers scan it in place
+static const char *cur = 0;
+static const char *fileEnd = 0;
+
+static inline void
+skipSpace()
+{
+    while(cur < fileEnd && (*cur == ' ' || *cur == '\n' || *cur == '\r' || *cur == '\t'))
+        ++cur;
+}
+
+static inline void
+skipLine()
+{
+    while(cur < fileEnd && *cur++ != '\n') ;
+}
+
+static bool
+scanNum(const char*& p, const char* end, unsigned& num)
+{
+    while(p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) ++p;
+    if(p == end || !isdigit(*p)) return false;
+    num = 0;
+    while(p < end && isdigit(*p))
+        num = num * 10 + (*p++ - '0');
+    return true;
+}
+
+static inline bool
+parseNum(unsigned& num)
+{
+    return scanNum(cur, fileEnd, num);
+}
+
+static bool
+parseNum(size_t& num)
+{
+    unsigned n;
+    if(!parseNum(n)) return false;
+    num = n;
+    return true;
+}
+
+// unsigned LEB128, 7 bits per byte with the MSB as continuation flag; a
+// 32-bit delta takes at most 5 bytes
+static inline void
+encodeDelta(string& buf, unsigned delta)
+{
+    while(delta & ~0x7fu)
+    {
+        buf += (char)((delta & 0x7f) | 0x80);
+        delta >>= 7;
+    }
+    buf += (char)delta;
+}
+
+static bool
+decodeDelta(unsigned& delta)
+{
+    delta = 0;
+    for(unsigned shift = 0; cur < fileEnd && shift <= 28; shift += 7)
+    {
+        unsigned char ch = *cur++;
+        delta |= (unsigned)(ch & 0x7f) << shift;
+        if(!(ch & 0x80)) return true;
+    }
+    return false;
+}
+
 static bool
 parseError(CirParseError err)
 {
@@ -146,74 +219,61 @@ parseError(CirParseError err)
    return false;
 }
 
+// Gates live in a table indexed by ID, so no literal may exceed 2M + 1
+static inline bool
+checkLit(unsigned lit, size_t M)
+{
+    if(lit / 2 <= M) return true;
+    errInt = lit;
+    return parseError(MAX_LIT_ID);
+}
+
 /**************************************************************/
 /*   class CirMgr member functions for circuit construction   */
 /**************************************************************/
 
-CirGate* CirMgr::const0 = new CirPiGate(0, 0);
+CirGate* CirMgr::const0 = ::new CirPiGate(0, 0);
 
 bool
-CirMgr::readCircuit(const string& fileName)
+CirMgr::readCircuit(const string& fileName, unsigned nThreads)
 {
     reset();
+    _nThreads = (nThreads ? nThreads : 1);
     CirGate::_globalRef = 0;
-    ifstream inFile(fileName);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    MyFileMap designFile;
 
-    if(!inFile)
+    if(!designFile.open(fileName))
     {
         cerr << "Cannot open design \"" << fileName << "\"!!\n";
         return false;
     }
+    cur = designFile.begin();
+    fileEnd = designFile.end();
 
-    if(!readHeader(inFile)) return false;
-    if(!readPI(inFile)) return false;
-    if(!readPO(inFile)) return false;
-    if(!readAig(inFile)) return false;
-    if(!readSymbol(inFile)) return false;
+    if(!readHeader()) return false;
+    if(!readPI()) return false;
+    if(!readPO()) return false;
+    if(_binary)
+    {
+        if(!readAigBinary()) return false;
+    }
+    else if(!readAig()) return false;
+    if(!readSymbol()) return false;
+    cur = fileEnd = 0;
+    _parseBytes = designFile.size();
+    _parseTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
 
     genDFSList();
 
-    for(size_t i = 0; i < _aigList.size(); ++i)
-    {
-        bool withFloatingFanin = false;
-        if(_gateList[_aigList[i]->_fanin0])
-            _gateList[_aigList[i]->_fanin0]->addFanout(_aigList[i]->_gateID);
-        else
-        {
-            withFloatingFanin = true;
-            _floGateList[_aigList[i]->_fanin0] = new CirUndefGate(_aigList[i]->_fanin0, M + O + 1);
-            _floGateList[_aigList[i]->_fanin0]->addFanout(_aigList[i]->_gateID);
-        }
-        if(_gateList[_aigList[i]->_fanin1])
-            _gateList[_aigList[i]->_fanin1]->addFanout(_aigList[i]->_gateID);
-        else
-        {
-            withFloatingFanin = true;
-            _floGateList[_aigList[i]->_fanin1] = new CirUndefGate(_aigList[i]->_fanin1, M + O + 1);
-            _floGateList[_aigList[i]->_fanin1]->addFanout(_aigList[i]->_gateID);
-        }
-        if(withFloatingFanin) _floting.push_back(_aigList[i]->_gateID);
-    }
-    
-    for(size_t i = 0; i < _poList.size(); ++i)
-    {
-        if(_gateList[_poList[i]->_fanin0])
-            _gateList[_poList[i]->_fanin0]->addFanout(_poList[i]->_gateID);
-        else
-        {
-            _floting.push_back(_poList[i]->_gateID);
-            _floGateList[_poList[i]->_fanin0] = new CirUndefGate(_poList[i]->_fanin0, M + O + 1);
-            _floGateList[_poList[i]->_fanin0]->addFanout(_poList[i]->_gateID);
-        }
-    }
+    connectFanouts();
 
     for(size_t i = 0; i < _piList.size(); ++i)
-        if(!_piList[i]->_fanout.size()) _unused.push_back(_piList[i]->_gateID);
+        if(!getFanoutNum(_piList[i]->_gateID)) _unused.push_back(_piList[i]->_gateID);
     for(size_t i = 0; i < _aigList.size(); ++i)
-        if(!_aigList[i]->_fanout.size()) _unused.push_back(_aigList[i]->_gateID);
+        if(!getFanoutNum(_aigList[i]->_gateID)) _unused.push_back(_aigList[i]->_gateID);
 
-    sort(_floting.begin(), _floting.end());
-    sort(_unused.begin(), _unused.end());
+    updateGateLists(true);
     
    return true;
 }
@@ -276,15 +336,15 @@ CirMgr::printFloatGates() const
     if(_floting.size())
     {
         cout << "Gates with floating fanin(s):";
-        for(size_t i = 0; i < _floting.size(); ++i)
-            cout << " " << _floting[i];
+        for(size_t i = 0; i < _floting.slots(); ++i)
+            if(!_floting.isHole(i)) cout << " " << _floting[i];
         cout << endl;
     }
     if(_unused.size())
     {
         cout << "Gates defined but not used  :";
-        for(size_t i = 0; i < _unused.size(); ++i)
-            cout << " " << _unused[i];
+        for(size_t i = 0; i < _unused.slots(); ++i)
+            if(!_unused.isHole(i)) cout << " " << _unused[i];
         cout << endl;
     }
 }
@@ -292,32 +352,20 @@ CirMgr::printFloatGates() const
 void
 CirMgr::printFECPairs() const
 {
-    size_t n = fecPairs.size();
-    vector<unsigned>* v;
-    for(size_t i = 0; i < n; ++i)
+    size_t n = 0;
+    for(unsigned c = 0; c < _fecClasses.size(); ++c)
     {
-        v = fecPairs.front();
-        fecPairs.pop();
-        if(v->size() > 1)
-            fecPairs.push(v);
-    }
-//    cout << "size = " << n << endl;
-    n = fecPairs.size();
-    for(size_t i = 0; i < n; ++i)
-    {
-        v = fecPairs.front();
-        fecPairs.pop();
-        sort(v->begin(), v->end());
-        cout << "[" << i << "] ";
-        for(size_t j = 0; j < v->size() - 1; ++j)
+        if(_fecClasses.classSize(c) < 2) continue;
+        _fecClasses.sortClass(c);
+        const unsigned* v = _fecClasses.members(c);
+        cout << "[" << n++ << "] ";
+        for(size_t j = 0; j < _fecClasses.classSize(c); ++j)
         {
-            if((*v)[j] % 2 == 1) cout << "!";
-            cout << (*v)[j] / 2 << " ";
+            if(j) cout << " ";
+            if(v[j] % 2 == 1) cout << "!";
+            cout << v[j] / 2;
         }
-        if((*v)[v->size() - 1] % 2 == 1) cout << "!";
-        cout << (*v)[v->size() - 1] / 2;
         cout << endl;
-        fecPairs.push(v);
     }
 }
 
@@ -329,8 +377,7 @@ CirMgr::printFanins(unsigned gateID, int curLevel, int level, bool inv)
     cout << setw(2 * (level - curLevel)) << "";
     if(inv) cout << "!";
     
-    CirGate* gate = _gateList[gateID];
-    if(!gate) gate = _floGateList[gateID];
+    CirGate* gate = getGate(gateID);
     
     string type = gate->getTypeStr();
     cout << type << " " << gateID;
@@ -351,15 +398,15 @@ CirMgr::printFanins(unsigned gateID, int curLevel, int level, bool inv)
     
     if(type == "PO")
     {
-        printFanins(gate->_fanin0, curLevel - 1, level, gate->_invPhase0);
-        if((_gateList[gate->_fanin0] != nullptr | _floGateList[gate->_fanin0] != nullptr) & (curLevel != 0)) gate->_ref = CirGate::_globalRef;
+        printFanins(gate->getFanin(0), curLevel - 1, level, gate->isFaninInv(0));
+        if((getGate(gate->getFanin(0)) != nullptr) & (curLevel != 0)) gate->_ref = CirGate::_globalRef;
     }
     
     if(type == "AIG")
     {
-        printFanins(gate->_fanin0, curLevel - 1, level, gate->_invPhase0);
-        printFanins(gate->_fanin1, curLevel - 1, level, gate->_invPhase1);
-        if(((_gateList[gate->_fanin0] != nullptr) | (_floGateList[gate->_fanin0] != nullptr) | (_gateList[gate->_fanin1] != nullptr) | (_floGateList[gate->_fanin1] != nullptr)) & (curLevel != 0)) gate->_ref = CirGate::_globalRef;
+        printFanins(gate->getFanin(0), curLevel - 1, level, gate->isFaninInv(0));
+        printFanins(gate->getFanin(1), curLevel - 1, level, gate->isFaninInv(1));
+        if(((getGate(gate->getFanin(0)) != nullptr) | (getGate(gate->getFanin(1)) != nullptr)) & (curLevel != 0)) gate->_ref = CirGate::_globalRef;
     }
 }
 
@@ -368,16 +415,15 @@ CirMgr::printFanouts(unsigned gateID, int curLevel, int level, unsigned from)
 {
     if(curLevel < 0) return;
     
-    CirGate* gate = _gateList[gateID];
-    if(!gate) gate = _floGateList[gateID];
+    CirGate* gate = getGate(gateID);
     
     cout << setw(2 * (level - curLevel)) << "";
     
     if(curLevel != level)
     {
         bool inv = false;
-        if((gate->_fanin0 == from) & (gate->_invPhase0)) inv = true;
-        if((gate->_fanin1 == from) & (gate->_invPhase1)) inv = true;
+        if((gate->getFanin(0) == from) & (gate->isFaninInv(0))) inv = true;
+        if((gate->getFanin(1) == from) & (gate->isFaninInv(1))) inv = true;
         if(inv) cout << "!";
     }
     
@@ -392,10 +438,10 @@ CirMgr::printFanouts(unsigned gateID, int curLevel, int level, unsigned from)
     
     cout << endl;
     
-    for(size_t i = 0; i < gate->_fanout.size(); ++i)
-        printFanouts(gate->_fanout[i], curLevel - 1, level, gateID);
+    for(size_t i = 0; i < getFanoutNum(gateID); ++i)
+        printFanouts(getFanout(gateID, i), curLevel - 1, level, gateID);
     
-    if(gate->_fanout.size() != 0 & curLevel != 0) gate->_ref = CirGate::_globalRef;
+    if(getFanoutNum(gateID) != 0 & curLevel != 0) gate->_ref = CirGate::_globalRef;
 }
 
 void
@@ -405,34 +451,29 @@ CirMgr::writeAag(ostream& outfile) const
     for(size_t i = 0; i < _aigList.size(); ++i)
         if(_aigList[i]->_canBeReached)
             adjA++;
-    outfile << "aag " << M << " " << I << " " << L << " " << O << " " << adjA << endl;
+    outfile << "aag " << M << " " << I << " " << L << " " << O << " " << adjA << "\n";
     
     for(size_t i = 0; i < _piList.size(); ++i)
-        outfile << _piList[i]->_gateID * 2 << endl;
+        outfile << _piList[i]->_gateID * 2 << "\n";
     
     for(size_t i = 0; i < _poList.size(); ++i)
     {
-        unsigned fanin = _poList[i]->_fanin0 * 2;
-        if(_poList[i]->_invPhase0) fanin++;
-        outfile << fanin << endl;
+        outfile << _poList[i]->getFaninLit(0) << "\n";
     }
     
     for(size_t i = 0; i < _aigList.size(); ++i)
     {
         if(!_aigList[i]->_canBeReached) continue;
-        unsigned fanin0 = _aigList[i]->_fanin0 * 2;
-        unsigned fanin1 = _aigList[i]->_fanin1 * 2;
-        if(_aigList[i]->_invPhase0) fanin0++;
-        if(_aigList[i]->_invPhase1) fanin1++;
-        outfile << _aigList[i]->_gateID * 2 << " " << fanin0 << " " << fanin1 << endl;
+        outfile << toLit(_aigList[i]->_gateID, false) << " " << _aigList[i]->getFaninLit(0)
+                << " " << _aigList[i]->getFaninLit(1) << "\n";
     }
     
     bool stop = false;
     
     for(size_t i = 0; i < _piList.size(); ++i)
     {
-        if(_piList[i]->_symbol.size())
-            outfile << "i" << i << " " << _piList[i]->_symbol << endl;
+        if(_piList[i]->getSymbol().size())
+            outfile << "i" << i << " " << _piList[i]->getSymbol() << "\n";
         else
         {
             stop = true;
@@ -443,8 +484,8 @@ CirMgr::writeAag(ostream& outfile) const
     if(!stop)
         for(size_t i = 0; i < _poList.size(); ++i)
         {
-            if(_poList[i]->_symbol.size())
-                outfile << "o" << i << " " << _poList[i]->_symbol << endl;
+            if(_poList[i]->getSymbol().size())
+                outfile << "o" << i << " " << _poList[i]->getSymbol() << "\n";
             else
             {
                 stop = true;
@@ -461,21 +502,21 @@ CirMgr::writeAag(ostream& outfile) const
 void
 CirMgr::writeGate(ostream& outfile, CirGate *g) const
 {
-    if(g->getTypeStr() != "AIG")
+    if(_gateType[g->_gateID] != AIG_GATE)
         cout << "Error: Gate(" << g->_gateID << ") is NOT an AIG!!\n";
     vector<unsigned> _pi;
 //    vector<CirGate*> _po;
     vector<CirGate*> _aig;
     vector<CirGate*> _dfs;
     CirGate::_globalRef++;
-    g->DFS(_gateList, _dfs);
+    dfs(g, _dfs, 0);
     for(size_t i = 0; i < _dfs.size(); ++i)
     {
-        if(_dfs[i]->getTypeStr() == "PI")
+        if(_gateType[_dfs[i]->_gateID] == PI_GATE)
             _pi.push_back(_dfs[i]->_gateID);
 //        else if(_dfs[i]->getTypeStr() == "PO")
 //            _po.push_back(_dfs[i]);
-        else if(_dfs[i]->getTypeStr() == "AIG")
+        else if(_gateType[_dfs[i]->_gateID] == AIG_GATE)
             _aig.push_back(_dfs[i]);
     }
     
@@ -484,25 +525,22 @@ CirMgr::writeGate(ostream& outfile, CirGate *g) const
     unsigned a = _aig.size();
     unsigned m = a + i;
     if(m < g->_gateID) m = g->_gateID;
-    outfile << "aag" << " " << m << " " << i << " 0 1 " << a << endl;
+    outfile << "aag" << " " << m << " " << i << " 0 1 " << a << "\n";
     sort(_pi.begin(), _pi.end());
     for(size_t k = 0; k < _pi.size(); ++k)
-        outfile << _pi[k]* 2 << endl;
-    outfile << g->_gateID * 2 << endl;
+        outfile << _pi[k]* 2 << "\n";
+    outfile << g->_gateID * 2 << "\n";
     for(size_t k = 0; k < _aig.size(); ++k)
     {
-        unsigned f1 = _aig[k]->_f0ptr->_gateID * 2;
-        unsigned f2 = _aig[k]->_f1ptr->_gateID * 2;
-        if(_aig[k]->_invPhase0) f1++;
-        if(_aig[k]->_invPhase1) f2++;
-        outfile << _aig[k]->_gateID * 2 << " " << f1 << " " << f2 << endl;
+        outfile << toLit(_aig[k]->_gateID, false) << " " << _aig[k]->getFaninLit(0)
+                << " " << _aig[k]->getFaninLit(1) << "\n";
     }
     for(size_t k = 0; k < _pi.size(); ++k)
     {
-        if(getGate(_pi[k])->_symbol.size())
-            cout << "i" << k << " " << getGate(_pi[k])->_symbol << endl;
+        if(getGate(_pi[k])->getSymbol().size())
+            outfile << "i" << k << " " << getGate(_pi[k])->getSymbol() << "\n";
     }
-    outfile << "o0 " << g->_gateID << endl;
+    outfile << "o0 " << g->_gateID << "\n";
     
     outfile << "c\n";
     outfile << "    (\\ (\\         期末好運兔兔\n";
@@ -510,13 +548,445 @@ CirMgr::writeGate(ostream& outfile, CirGate *g) const
     outfile << "-----------------\n";
 }
 
+// Binary AIGER of the whole circuit: only the ANDs reachable from the POs,
+// renumbered after the PIs in _dfsList (i.e. topological) order.
+void
+CirMgr::writeAig(ostream& outfile) const
+{
+    vector<CirGate*> pis(_piList), aigs;
+    vector<unsigned> poLits;
+    for(size_t i = 0; i < _dfsList.size(); ++i)
+        if(_dfsList[i]->isAig()) aigs.push_back(_dfsList[i]);
+    for(size_t i = 0; i < _poList.size(); ++i)
+        poLits.push_back(_poList[i]->getFaninLit(0));
+    writeAig(outfile, pis, aigs, poLits, _poList);
+}
+
+// Binary AIGER of the fanin cone of AIG "g"; same PIs as writeGate().
+void
+CirMgr::writeAig(ostream& outfile, CirGate *g) const
+{
+    vector<CirGate*> cone, pis, aigs;
+    CirGate::_globalRef++;
+    dfs(g, cone, 0);
+    for(size_t i = 0; i < cone.size(); ++i)
+    {
+        if(_gateType[cone[i]->_gateID] == PI_GATE) pis.push_back(cone[i]);
+        else if(cone[i]->isAig()) aigs.push_back(cone[i]);
+    }
+    sort(pis.begin(), pis.end(), [](CirGate* a, CirGate* b) { return a->_gateID < b->_gateID; });
+    vector<unsigned> poLits(1, g->_gateID * 2);
+    writeAig(outfile, pis, aigs, poLits, vector<CirGate*>());
+}
+
+// "aigs" must be topologically ordered. Input k becomes variable k+1 and
+// AND j variable I+j+1; UNDEF fanins are written as constant 0. The whole
+// file is assembled in one buffer and written at once.
+void
+CirMgr::writeAig(ostream& outfile, const vector<CirGate*>& pis,
+                 const vector<CirGate*>& aigs, const vector<unsigned>& poLits,
+                 const vector<CirGate*>& pos) const
+{
+    vector<unsigned> varOf(M + O + 2, 0);
+    unsigned nVar = 0;
+    for(size_t i = 0; i < pis.size(); ++i)
+        varOf[pis[i]->_gateID] = ++nVar;
+    for(size_t i = 0; i < aigs.size(); ++i)
+        varOf[aigs[i]->_gateID] = ++nVar;
+
+    string buf;
+    buf.reserve(64 + 8 * poLits.size() + 4 * aigs.size());
+    buf += "aig " + to_string(nVar) + " " + to_string(pis.size()) + " 0 "
+         + to_string(poLits.size()) + " " + to_string(aigs.size()) + "\n";
+    for(size_t i = 0; i < poLits.size(); ++i)
+        buf += to_string(toLit(varOf[litID(poLits[i])], litInv(poLits[i]))) + "\n";
+    for(size_t i = 0; i < aigs.size(); ++i)
+    {
+        unsigned lhs = varOf[aigs[i]->_gateID] * 2;
+        unsigned rhs0 = toLit(varOf[aigs[i]->getFanin(0)], aigs[i]->isFaninInv(0));
+        unsigned rhs1 = toLit(varOf[aigs[i]->getFanin(1)], aigs[i]->isFaninInv(1));
+        if(rhs0 < rhs1) swap(rhs0, rhs1);
+        assert(lhs > rhs0);
+        encodeDelta(buf, lhs - rhs0);
+        encodeDelta(buf, rhs0 - rhs1);
+    }
+    for(size_t i = 0; i < pis.size(); ++i)
+        if(pis[i]->getSymbol().size())
+            buf += "i" + to_string(i) + " " + pis[i]->getSymbol() + "\n";
+    for(size_t i = 0; i < pos.size(); ++i)
+        if(pos[i]->getSymbol().size())
+            buf += "o" + to_string(i) + " " + pos[i]->getSymbol() + "\n";
+    buf += "c\n";
+    buf += "    (\\ (\\         期末好運兔兔\n";
+    buf += "c(￣(_ˊ• x •`)_—☆\n";
+    buf += "-----------------\n";
+    outfile.write(buf.data(), buf.size());
+}
+
 void
 CirMgr::genDFSList()
 {
     CirGate::_globalRef++;
     _dfsList.clear();
+    _dfsStart.assign(_gateList.size(), 0);
     for(size_t i = 0; i < _poList.size(); ++i)
-        _poList[i]->DFS(_gateList, _dfsList);
+        dfs(_poList[i], _dfsList, &_dfsStart);
+    _dfsPos.assign(_gateList.size(), 0);
+    for(size_t i = 0; i < _dfsList.size(); ++i)
+        _dfsPos[_dfsList[i]->_gateID] = i;
+    _dfsDirty = false;
+    buildAigStore();
+}
+
+// Post-order DFS over the defined fanins, skipping the gates already marked
+// with CirGate::_globalRef. The stack is explicit, so long chains cannot
+// overflow the call stack. "start", if given, gets for each gate entered
+// the size "order" had at that time.
+void
+CirMgr::dfs(CirGate* root, vector<CirGate*>& order, vector<unsigned>* start) const
+{
+    if(root->_ref == CirGate::_globalRef) return;
+    if(start) (*start)[root->_gateID] = order.size();
+    vector<pair<CirGate*, unsigned> > stack(1, make_pair(root, 0u));
+    while(!stack.empty())
+    {
+        CirGate* g = stack.back().first;
+        unsigned nFanin = (_gateType[g->_gateID] == AIG_GATE ? 2 :
+                           _gateType[g->_gateID] == PO_GATE ? 1 : 0);
+        CirGate* next = 0;
+        while(!next && stack.back().second < nFanin)
+        {
+            next = getDefGate(g->getFanin(stack.back().second++));
+            if(next && next->_ref == CirGate::_globalRef) next = 0;
+        }
+        if(next)
+        {
+            if(start) (*start)[next->_gateID] = order.size();
+            stack.push_back(make_pair(next, 0u));
+            continue;
+        }
+        order.push_back(g);
+        g->_ref = CirGate::_globalRef;
+        g->_canBeReached = true;
+        stack.pop_back();
+    }
+}
+
+// "gate" has just been merged into "mgid" during a pass. Emptying its slot
+// gives the order genDFSList() would give as long as gate reached nothing
+// of its own (its fanins were all entered before it) and mgid is already
+// in the list before it; failing that, updateDFSList() will rebuild.
+void
+CirMgr::dropFromDFSList(CirGate* gate, unsigned mgid)
+{
+    unsigned gid = gate->_gateID;
+    if(_dfsPos[gid] >= _dfsList.size() || _dfsList[_dfsPos[gid]] != gate) return;    // unreachable
+    _dfsList[_dfsPos[gid]] = 0;
+    if(_dfsDirty) return;
+    for(size_t k = 0; k < (gate->isAig() ? 2 : 1); ++k)
+        if(getDefGate(gate->getFanin(k)) && _dfsPos[gate->getFanin(k)] >= _dfsStart[gid])
+            _dfsDirty = true;
+    CirGate* mgate = getDefGate(mgid);
+    if(mgate && (_dfsPos[mgid] >= _dfsStart[gid] || _dfsList[_dfsPos[mgid]] != mgate))
+        _dfsDirty = true;
+}
+
+// End of a pass of local merges: squeeze out the emptied slots, or rebuild
+// the order if some merge moved other gates as well
+void
+CirMgr::updateDFSList()
+{
+    if(_dfsDirty)
+    {
+        genDFSList();
+        return;
+    }
+    vector<unsigned> live(_dfsList.size() + 1);     // gates left before each slot
+    size_t n = 0;
+    for(size_t i = 0; i < _dfsList.size(); ++i)
+    {
+        live[i] = n;
+        if(_dfsList[i]) _dfsList[n++] = _dfsList[i];
+    }
+    live[_dfsList.size()] = n;
+    _dfsList.resize(n);
+    for(size_t i = 0; i < n; ++i)
+    {
+        unsigned id = _dfsList[i]->_gateID;
+        _dfsPos[id] = i;
+        _dfsStart[id] = live[_dfsStart[id]];
+    }
+    buildAigStore();
+}
+
+// O(1): the slot is emptied here and squeezed out by updateGateLists()
+void
+CirMgr::dropFromAigList(CirGate* gate)
+{
+    unsigned gid = gate->_gateID;
+    if(_aigPos[gid] < _aigList.size() && _aigList[_aigPos[gid]] == gate)
+        _aigList[_aigPos[gid]] = 0;
+}
+
+// End of a pass: close the holes left in _aigList, _floting and _unused,
+// keeping their order (or sorting the last two)
+void
+CirMgr::updateGateLists(bool sorted)
+{
+    size_t n = 0;
+    _aigPos.assign(_gateList.size(), noPos);
+    for(size_t i = 0; i < _aigList.size(); ++i)
+    {
+        if(!_aigList[i]) continue;
+        _aigPos[_aigList[i]->_gateID] = n;
+        _aigList[n++] = _aigList[i];
+    }
+    _aigList.resize(n);
+    _floting.compact(sorted);
+    _unused.compact(sorted);
+}
+
+void
+CirMgr::buildAigStore()
+{
+    size_t n = _gateList.size();
+    _level.assign(n, 0);
+    _simVal.resize(n);              // unreachable gates keep their values
+    _simQueued.assign(n, 0);
+
+    _topoOrder.clear();
+    _topoOrder.reserve(_dfsList.size());
+    for(size_t i = 0; i < _dfsList.size(); ++i)
+    {
+        if(!_dfsList[i]) continue;
+        unsigned id = _dfsList[i]->_gateID;
+        unsigned l0 = _level[litID(_fanin0Lit[id])], l1 = _level[litID(_fanin1Lit[id])];
+        if(_gateType[id] == AIG_GATE) _level[id] = (l0 > l1 ? l0 : l1) + 1;
+        else if(_gateType[id] == PO_GATE) _level[id] = l0;
+        _topoOrder.push_back(id);
+    }
+
+    // counting sort into the level buckets, stable so that each bucket
+    // keeps the DFS order
+    unsigned depth = 0;
+    for(size_t i = 0; i < _topoOrder.size(); ++i)
+        if(_level[_topoOrder[i]] > depth) depth = _level[_topoOrder[i]];
+    _levelStart.assign(depth + 3, 0);
+    for(size_t i = 0; i < _topoOrder.size(); ++i)
+    {
+        unsigned id = _topoOrder[i];
+        ++_levelStart[(_gateType[id] == PO_GATE ? depth + 1 : _level[id]) + 1];
+    }
+    for(size_t l = 1; l < _levelStart.size(); ++l)
+        _levelStart[l] += _levelStart[l - 1];
+    _levelOrder.resize(_topoOrder.size());
+    vector<unsigned> next(_levelStart.begin(), _levelStart.end() - 1);
+    for(size_t i = 0; i < _topoOrder.size(); ++i)
+    {
+        unsigned id = _topoOrder[i];
+        _levelOrder[next[_gateType[id] == PO_GATE ? depth + 1 : _level[id]]++] = id;
+    }
+}
+
+// Fanouts are kept in the order of _aigList followed by _poList. With
+// several threads each one owns a slice of those gates (so of the edges):
+// the slices count their fanins separately, the counts are summed into the
+// rows, and each slice then fills its own part of every row, after the
+// parts of the slices before it.
+void
+CirMgr::connectFanouts()
+{
+    const unsigned nSlices = (_nThreads > 1 && A >= parallelMinAig ? _nThreads : 1);
+    const unsigned maxID = M + O + 1;
+    const size_t nGates = _aigList.size() + _poList.size();
+    vector<char> floating(2 * _aigList.size() + _poList.size(), 0);
+    // the arena is not thread-safe: create the UNDEF gates up front
+    for(size_t i = 0; i < nGates; ++i)
+    {
+        CirGate* gate = (i < _aigList.size() ? _aigList[i] : _poList[i - _aigList.size()]);
+        unsigned nFanin = (gate->isAig() ? 2 : 1);
+        for(unsigned j = 0; j < nFanin; ++j)
+        {
+            unsigned fanin = gate->getFanin(j);
+            if(!_gateList[fanin])
+            {
+                _gateList[fanin] = new (_gateArena) CirUndefGate(fanin);
+                // an UNDEF gate's fanins point past the last gate, at no gate
+                setFanins(fanin, toLit(M + O + 1, false), toLit(M + O + 1, false));
+            }
+        }
+    }
+    auto bySlices = [&](const function<void(unsigned)>& f) {
+        if(nSlices == 1)
+        {
+            f(0);
+            return;
+        }
+        vector<thread> workers;
+        for(unsigned k = 0; k < nSlices; ++k)
+            workers.push_back(thread(f, k));
+        for(unsigned k = 0; k < nSlices; ++k) workers[k].join();
+    };
+
+    // count per slice; then, by gate ID, turn the counts into each slice's
+    // first position in the row
+    vector<vector<unsigned> > next(nSlices);
+    bySlices([&](unsigned k) {
+        next[k].assign(maxID, 0);
+        countFanoutSlice(nGates * k / nSlices, nGates * (k + 1) / nSlices, next[k]);
+    });
+    _foSize.assign(maxID, 0);
+    bySlices([&](unsigned k) {
+        for(unsigned g = maxID * k / nSlices; g < maxID * (k + 1) / nSlices; ++g)
+            for(unsigned s = 0; s < nSlices; ++s)
+            {
+                unsigned n = next[s][g];
+                next[s][g] = _foSize[g];
+                _foSize[g] += n;
+            }
+    });
+    layoutFanouts();
+    bySlices([&](unsigned k) {
+        for(unsigned g = 0; g < maxID; ++g) next[k][g] += _foOffset[g];
+        connectFanoutSlice(nGates * k / nSlices, nGates * (k + 1) / nSlices, next[k], floating);
+    });
+
+    for(size_t i = 0; i < _aigList.size(); ++i)
+        if(floating[2 * i] | floating[2 * i + 1]) _floting.push_back(_aigList[i]->_gateID);
+    for(size_t i = 0; i < _poList.size(); ++i)
+        if(floating[2 * _aigList.size() + i]) _floting.push_back(_poList[i]->_gateID);
+}
+
+// Fanin counts of the gates at [lo, hi) of _aigList + _poList, by fanin ID
+void
+CirMgr::countFanoutSlice(size_t lo, size_t hi, vector<unsigned>& cnt) const
+{
+    for(size_t i = lo; i < hi; ++i)
+    {
+        CirGate* gate = (i < _aigList.size() ? _aigList[i] : _poList[i - _aigList.size()]);
+        ++cnt[gate->getFanin(0)];
+        if(gate->isAig()) ++cnt[gate->getFanin(1)];
+    }
+}
+
+// Fanout edges of the gates at [lo, hi) of _aigList + _poList. next[g] is
+// where this slice's next fanout of g goes in _foTarget.
+void
+CirMgr::connectFanoutSlice(size_t lo, size_t hi, vector<unsigned>& next,
+                           vector<char>& floating)
+{
+    for(size_t i = lo; i < hi; ++i)
+    {
+        CirGate* gate = (i < _aigList.size() ? _aigList[i] : _poList[i - _aigList.size()]);
+        unsigned nFanin = (gate->isAig() ? 2 : 1);
+        for(unsigned j = 0; j < nFanin; ++j)
+        {
+            unsigned fanin = gate->getFanin(j);
+            if(_gateType[fanin] == UNDEF_GATE)
+            {
+                floating[gate->isAig() ? 2 * i + j : _aigList.size() + i] = 1;
+            }
+            _foTarget[next[fanin]++] = gate->_gateID;
+        }
+    }
+}
+
+// Lay the rows out back to back from _foSize, with no edits pending.
+// The caller fills them in.
+void
+CirMgr::layoutFanouts()
+{
+    const size_t n = _foSize.size();
+    _foOffset.assign(n, 0);
+    for(size_t g = 1; g < n; ++g) _foOffset[g] = _foOffset[g - 1] + _foSize[g - 1];
+    _foLen = _foSize;
+    _foTarget.resize(n ? _foOffset[n - 1] + _foSize[n - 1] : 0);
+    _foLastEdit.assign(n, noPos);
+    _foEdits.clear();
+    _foDirtyCnt = 0;
+    _foDead = 0;
+}
+
+// The indices of gid's edits after log entry 'since' (noPos: all of them),
+// in log order
+void
+CirMgr::fanoutEdits(unsigned gid, unsigned since, vector<unsigned>& chain) const
+{
+    chain.clear();
+    for(unsigned k = _foLastEdit[gid]; k != noPos && k != since; k = _foEdits[k].prev)
+        chain.push_back(k);
+    reverse(chain.begin(), chain.end());
+}
+
+// Replay gid's pending edits into its row. The row is rewritten in place
+// unless it grew, in which case it moves to the end of _foTarget.
+void
+CirMgr::foldFanouts(unsigned gid) const
+{
+    fanoutEdits(gid, noPos, _foChain);
+    const unsigned* row = _foTarget.data() + _foOffset[gid];
+    _foRow.assign(row, row + _foLen[gid]);
+    for(size_t k = 0; k < _foChain.size(); ++k)
+    {
+        const CirFanoutEdit& edit = _foEdits[_foChain[k]];
+        if(edit.add) _foRow.push_back(edit.fanout);
+        else _foRow.erase(edit.fanout);
+    }
+    const unsigned len = _foRow.size();
+    if(len > _foLen[gid])
+    {
+        _foDead += _foLen[gid];
+        _foOffset[gid] = _foTarget.size();
+        _foTarget.resize(_foTarget.size() + len);
+    }
+    else _foDead += _foLen[gid] - len;
+    unsigned* out = _foTarget.data() + _foOffset[gid];
+    for(size_t i = 0; i < _foRow.slots(); ++i)
+        if(!_foRow.isHole(i)) *out++ = _foRow[i];
+    _foLen[gid] = _foSize[gid] = len;
+    _foLastEdit[gid] = noPos;
+    if(--_foDirtyCnt == 0) _foEdits.clear();
+    if(_foDead > _foTarget.size() / 2) packFanouts();
+}
+
+// Squeeze the dead slots out of _foTarget; pending edits stay in the log
+void
+CirMgr::packFanouts() const
+{
+    vector<unsigned> target;
+    target.reserve(_foTarget.size() - _foDead);
+    for(size_t g = 0; g < _foOffset.size(); ++g)
+    {
+        const unsigned* row = _foTarget.data() + _foOffset[g];
+        _foOffset[g] = target.size();
+        target.insert(target.end(), row, row + _foLen[g]);
+    }
+    _foTarget.swap(target);
+    _foDead = 0;
+}
+
+// The one way to change an edge after parsing
+void
+CirMgr::setFanin(CirGate* g, size_t i, unsigned lit)
+{
+    (i ? _fanin1Lit : _fanin0Lit)[g->_gateID] = lit;
+}
+
+void
+CirMgr::destroyGate(CirGate* g)
+{
+    g->~CirGate();
+}
+
+// Run the destructors, then hand all the gate memory back in one go
+void
+CirMgr::clearGates()
+{
+    for(size_t i = 0; i < _gateList.size(); ++i)
+        if(_gateList[i] && _gateList[i] != const0) destroyGate(_gateList[i]);
+    _gateList.clear();
+    _gateType.clear();
+    _gateArena.reset();
 }
 
 void
@@ -524,56 +994,89 @@ CirMgr::reset()
 {
     lineNo = 0;
     colNo = 0;
-    _gateList.clear();
-    _floGateList.clear();   //
+    clearGates();
     _piList.clear();
     _poList.clear();
     _aigList.clear();
+    _aigPos.clear();
     _dfsList.clear();
+    _dfsPos.clear();
+    _dfsStart.clear();
+    _dfsDirty = false;
     _floting.clear();
     _unused.clear();
     const0->_ref = 0;
-    const0->_fanout.clear();
+    _foOffset.clear();
+    _foLen.clear();
+    _foTarget.clear();
+    _foSize.clear();
+    _foLastEdit.clear();
+    _foEdits.clear();
+    _foDirtyCnt = _foDead = 0;
+    _fanin0Lit.clear();
+    _fanin1Lit.clear();
+    _symbols.clear();
+    _value.clear();
     CirGate::_globalRef = 0;
     
-    while(fecPairs.size())
-        fecPairs.pop();
-    SATpatterns.clear();
+    _fecClasses.clear();
+    _satWords.clear();
+    _satCnt = 0;
 }
 
 bool
-CirMgr::readHeader(ifstream& inFile)
-{
-    string command;
-    inFile >> command;
-    inFile >> command;
-    M = stoi(command);
-    inFile >> command;
-    I = stoi(command);
-    inFile >> command;
-    L = stoi(command);
-    inFile >> command;
-    O = stoi(command);
-    inFile >> command;
-    A = stoi(command);
-
+CirMgr::readHeader()
+{
+    skipSpace();
+    const char* tok = cur;
+    while(cur < fileEnd && !isspace(*cur)) ++cur;
+    string command(tok, cur);
+    if(command == "aig") _binary = true;
+    else if(command == "aag") _binary = false;
+    else
+    {
+        errMsg = command;
+        return parseError(ILLEGAL_IDENTIFIER);
+    }
+    errMsg = "number of variables";
+    if(!parseNum(M)) return parseError(MISSING_NUM);
+    errMsg = "number of PIs";
+    if(!parseNum(I)) return parseError(MISSING_NUM);
+    errMsg = "number of latches";
+    if(!parseNum(L)) return parseError(MISSING_NUM);
+    errMsg = "number of POs";
+    if(!parseNum(O)) return parseError(MISSING_NUM);
+    errMsg = "number of AIGs";
+    if(!parseNum(A)) return parseError(MISSING_NUM);
+
+    _gateList.assign(M + O + 1, 0);
+    _gateType.assign(M + O + 1, UNDEF_GATE);
+    _fanin0Lit.assign(M + O + 1, 0);
+    _fanin1Lit.assign(M + O + 1, 0);
+    _value.assign(M + O + 1, 0);
+    _piList.reserve(I);
+    _poList.reserve(O);
+    _aigList.reserve(A);
     return true;
 }
 
 bool
-CirMgr::readPI(ifstream& inFile)
+CirMgr::readPI()
 {
-    _gateList[0] = const0;
-    string command;
+    setGate(0, const0, CONST_GATE);
+    errMsg = "PI literal ID";
 
     for(size_t i = 0; i < I; ++i)
     {
+        // Binary AIGER leaves the inputs implicit (2, 4, ..., 2I);
+        // lineNo still advances so line numbers match the .aag form.
         lineNo++;
-        inFile >> command;
-        unsigned lit = stoi(command);
+        unsigned lit = 2 * (i + 1);
+        if(!_binary && !parseNum(lit)) return parseError(MISSING_NUM);
+        if(!checkLit(lit, M)) return false;
         unsigned gateID = lit / 2;
-        CirGate* pi = new CirPiGate(gateID, lineNo);
-        _gateList[gateID] = pi;
+        CirGate* pi = new (_gateArena) CirPiGate(gateID, lineNo);
+        setGate(gateID, pi, PI_GATE);
         _piList.push_back(pi);
     }
 
@@ -581,17 +1084,18 @@ CirMgr::readPI(ifstream& inFile)
 }
 
 bool
-CirMgr::readPO(ifstream& inFile)
+CirMgr::readPO()
 {
-    string command;
+    errMsg = "PO literal ID";
     for(size_t i = 0; i < O; ++i)
     {
         lineNo++;
-        inFile >> command;
-        unsigned lit = stoi(command);
-//        unsigned fanin = lit / 2;
-        CirGate* po = new CirPoGate(M + 1 + i, lineNo, lit);
-        _gateList[M + 1 + i] = po;
+        unsigned lit;
+        if(!parseNum(lit)) return parseError(MISSING_NUM);
+        if(!checkLit(lit, M)) return false;
+        CirGate* po = new (_gateArena) CirPoGate(M + 1 + i, lineNo);
+        setFanins(M + 1 + i, lit);
+        setGate(M + 1 + i, po, PO_GATE);
         _poList.push_back(po);
     }
 
@@ -599,85 +1103,195 @@ CirMgr::readPO(ifstream& inFile)
 }
 
 bool
-CirMgr::readAig(ifstream& inFile)
+CirMgr::readAig()
 {
-    string command;
+    if(_nThreads > 1 && A >= parallelMinAig) return readAigParallel();
+    errMsg = "AIG literal ID";
     for(size_t i = 0; i < A; ++i)
     {
         lineNo++;
-        inFile >> command;
-        unsigned lit = stoi(command);
+        unsigned lit, fanin0, fanin1;
+        if(!parseNum(lit) || !parseNum(fanin0) || !parseNum(fanin1))
+            return parseError(MISSING_NUM);
+        if(!checkLit(lit, M) || !checkLit(fanin0, M) || !checkLit(fanin1, M))
+            return false;
         unsigned gateID = lit / 2;
-        unsigned fanin0, fanin1;
-        inFile >> command;
-        fanin0 = stoi(command);
-        inFile >> command;
-        fanin1 = stoi(command);
-        CirGate* aig = new CirAigGate(gateID, lineNo, fanin0, fanin1);
-        _gateList[gateID] = aig;
+        CirGate* aig = new (_gateArena) CirAigGate(gateID, lineNo);
+        setFanins(gateID, fanin0, fanin1);
+        setGate(gateID, aig, AIG_GATE);
         _aigList.push_back(aig);
     }
 
     return true;
 }
 
+// Every AND line is independent: cut the section into _nThreads chunks at
+// newline boundaries, let each thread decode its lines into the
+// preallocated literal arrays, then create the gates in file order.
 bool
-CirMgr::readSymbol(ifstream& inFile)
+CirMgr::readAigParallel()
 {
-    string command;
-    bool done = false;
-    while(true)
+    skipLine();
+    const unsigned nChunks = _nThreads;
+    vector<const char*> bound(nChunks + 1, fileEnd);
+    bound[0] = cur;
+    for(unsigned k = 1; k < nChunks; ++k)
     {
-        lineNo++;
-        inFile >> command;
-
-        if(inFile.eof()) break;
-        if(command[0] == 'c')
-        {
-            done = true;
-            break;
-        }
+        const char* p = cur + (fileEnd - cur) * k / nChunks;
+        if(p < bound[k - 1]) p = bound[k - 1];
+        while(p < fileEnd && p[-1] != '\n') ++p;
+        bound[k] = p;
+    }
 
-        string type = command.substr(0, 1);
-        command = command.substr(1);
-        unsigned index = stoi(command);
+    // pass 1: lines per chunk, giving the index of each chunk's first line.
+    // scanNum() skips blank lines, so they are not counted.
+    vector<size_t> firstLine(nChunks + 1, 0);
+    vector<thread> workers;
+    for(unsigned k = 0; k < nChunks; ++k)
+        workers.push_back(thread([&bound, &firstLine, k]() {
+            size_t n = 0;
+            bool blank = true;
+            for(const char* p = bound[k]; p < bound[k + 1]; ++p)
+            {
+                if(*p == '\n')
+                {
+                    if(!blank) ++n;
+                    blank = true;
+                }
+                else if(*p != ' ' && *p != '\r' && *p != '\t') blank = false;
+            }
+            firstLine[k + 1] = n + !blank;
+        }));
+    for(unsigned k = 0; k < nChunks; ++k) workers[k].join();
+    workers.clear();
+    for(unsigned k = 0; k < nChunks; ++k) firstLine[k + 1] += firstLine[k];
+
+    // pass 2: decode; lines beyond the A-th one belong to the symbol table
+    vector<unsigned> lits(A), fanin0(A), fanin1(A);
+    vector<size_t> badLine(nChunks, A);
+    const char* sectionEnd = 0;
+    for(unsigned k = 0; k < nChunks; ++k)
+        workers.push_back(thread([&, k]() {
+            const char* p = bound[k];
+            for(size_t i = firstLine[k]; i < A && i < firstLine[k + 1]; ++i)
+            {
+                if(!scanNum(p, bound[k + 1], lits[i]) || !scanNum(p, bound[k + 1], fanin0[i]) ||
+                   !scanNum(p, bound[k + 1], fanin1[i]))
+                {
+                    badLine[k] = i;
+                    return;
+                }
+                if(i == A - 1) sectionEnd = p;
+                while(p < bound[k + 1] && *p++ != '\n') ;
+            }
+        }));
+    for(unsigned k = 0; k < nChunks; ++k) workers[k].join();
 
-        inFile >> command;
+    size_t bad = *min_element(badLine.begin(), badLine.end());
+    if(bad < A || !sectionEnd)
+    {
+        lineNo += (bad < A ? bad : firstLine[nChunks]) + 1;
+        errMsg = "AIG literal ID";
+        return parseError(MISSING_NUM);
+    }
 
-        if(type == "i")
-            _piList[index]->setSymbol(command);
-        if(type == "o")
-            _poList[index]->setSymbol(command);
+    for(size_t i = 0; i < A; ++i)
+    {
+        if(!checkLit(lits[i], M) || !checkLit(fanin0[i], M) || !checkLit(fanin1[i], M))
+        {
+            lineNo += i + 1;
+            return false;
+        }
+        CirGate* aig = new (_gateArena) CirAigGate(lits[i] / 2, lineNo + i + 1);
+        setFanins(lits[i] / 2, fanin0[i], fanin1[i]);
+        setGate(lits[i] / 2, aig, AIG_GATE);
+        _aigList.push_back(aig);
     }
+    lineNo += A;
+    cur = sectionEnd;
 
     return true;
 }
 
+// Binary AIGER: gate i is 2(I+L+i+1) and is followed by two LEB128 deltas,
+// lhs - rhs0 and rhs0 - rhs1 (rhs0 >= rhs1).
+bool
+CirMgr::readAigBinary()
+{
+    // skip the rest of the last ASCII line; the delta bytes start right after
+    skipLine();
+    errMsg = "AIG delta";
+    for(size_t i = 0; i < A; ++i)
+    {
+        lineNo++;
+        unsigned lit = 2 * (I + L + i + 1);
+        unsigned delta0, delta1;
+        if(!checkLit(lit, M)) return false;
+        if(!decodeDelta(delta0) || !decodeDelta(delta1))
+            return parseError(MISSING_NUM);
+        unsigned fanin0 = lit - delta0;
+        unsigned fanin1 = fanin0 - delta1;
+        if(!checkLit(fanin0, M) || !checkLit(fanin1, M)) return false;
+        CirGate* aig = new (_gateArena) CirAigGate(lit / 2, lineNo);
+        setFanins(lit / 2, fanin0, fanin1);
+        setGate(lit / 2, aig, AIG_GATE);
+        _aigList.push_back(aig);
+    }
 
+    return true;
+}
 
+bool
+CirMgr::readSymbol()
+{
+    while(true)
+    {
+        lineNo++;
+        skipSpace();
+        if(cur == fileEnd || *cur == 'c') break;
+
+        char type = *cur++;
+        unsigned index;
+        errMsg = "symbol index";
+        if(!parseNum(index)) return parseError(MISSING_NUM);
+        if(cur < fileEnd && *cur == ' ') ++cur;
+        const char* name = cur;
+        while(cur < fileEnd && *cur != '\n' && *cur != '\r') ++cur;
+        string symbol(name, cur);
+
+        if(type == 'i' && index < _piList.size())
+            _symbols[_piList[index]->_gateID] = symbol;
+        if(type == 'o' && index < _poList.size())
+            _symbols[_poList[index]->_gateID] = symbol;
+    }
 
+    return true;
+}
 
+// AIGs reached from the POs, by level
+void
+CirMgr::printLevels() const
+{
+    size_t depth = (_levelStart.size() > 2 ? _levelStart.size() - 3 : 0);
+    cout << "\nCircuit Levels\n"
+    << "==============\n"
+    << "  Level     AIGs\n";
+    for(size_t l = 1; l <= depth; ++l)
+        cout << "  " << left << setw(6) << l << right << setw(8)
+        << _levelStart[l + 1] - _levelStart[l] << endl;
+    cout << "------------------\n"
+    << "  Depth" << right << setw(9) << depth << endl;
+}
 
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
+void
+CirMgr::printParseStats() const
+{
+    double mb = _parseBytes / 1048576.0;
+    size_t gates = I + O + A;
+    cout << "Parsed " << fixed << setprecision(2) << mb << " MB, " << gates
+         << " gates in " << setprecision(3) << _parseTime << " s";
+    if(_parseTime > 0)
+        cout << " (" << setprecision(1) << mb / _parseTime << " MB/s, "
+             << setprecision(0) << gates / _parseTime << " gates/s)";
+    cout << defaultfloat << setprecision(6) << endl;
+}
@@ -16,15 +16,316 @@
 #include <queue>
 #include <map>
 #include <algorithm>
+#include <new>
+#include <cstdlib>
+#include <cstring>
 
 using namespace std;
 
 // TODO: Feel free to define your own classes, variables, or functions.
 
 #include "cirDef.h"
+#include "myArena.h"
 
 extern CirMgr *cirMgr;
 
+// Below this many AIGs a threaded load is not worth starting threads for
+const size_t parallelMinAig = 1 << 14;
+
+const unsigned noID = ~0u;      // not a gate ID
+const unsigned noPos = ~0u;
+
+// A list of gate IDs edited like a vector<unsigned> with push_back() and
+// erase(find()): erase() drops the first live copy of the ID. Both are O(1);
+// an erased entry is left as a hole, so positions never move until
+// compact().
+class CirIdList
+{
+public:
+    CirIdList(): _size(0) {}
+
+    void clear()
+    {
+        for(size_t i = 0; i < _ids.size(); ++i)
+            if(_ids[i] != noID) _head[_ids[i]] = _tail[_ids[i]] = noPos;
+        _ids.clear();
+        _next.clear();
+        _size = 0;
+    }
+    void assign(const unsigned* b, const unsigned* e)
+    {
+        clear();
+        for(; b != e; ++b) push_back(*b);
+    }
+    void push_back(unsigned id)
+    {
+        if(id >= _head.size())
+        {
+            _head.resize(id + 1, noPos);
+            _tail.resize(id + 1, noPos);
+        }
+        unsigned p = _ids.size();
+        _ids.push_back(id);
+        _next.push_back(noPos);
+        if(_head[id] == noPos) _head[id] = p;
+        else _next[_tail[id]] = p;
+        _tail[id] = p;
+        ++_size;
+    }
+    bool erase(unsigned id)
+    {
+        if(id >= _head.size() || _head[id] == noPos) return false;
+        unsigned p = _head[id];
+        _head[id] = _next[p];
+        if(_head[id] == noPos) _tail[id] = noPos;
+        _ids[p] = noID;
+        --_size;
+        return true;
+    }
+    size_t size() const { return _size; }
+    size_t slots() const { return _ids.size(); }     // holes included
+    bool isHole(size_t i) const { return _ids[i] == noID; }
+    unsigned operator [] (size_t i) const { return _ids[i]; }
+    void appendTo(vector<unsigned>& v) const
+    {
+        for(size_t i = 0; i < _ids.size(); ++i)
+            if(_ids[i] != noID) v.push_back(_ids[i]);
+    }
+    // squeeze out the holes (positions change), optionally sorting
+    void compact(bool sorted = false)
+    {
+        vector<unsigned> v;
+        appendTo(v);
+        if(sorted) std::sort(v.begin(), v.end());
+        assign(v.data(), v.data() + v.size());
+    }
+
+private:
+    vector<unsigned>    _ids;
+    vector<unsigned>    _next;      // next position with the same ID
+    vector<unsigned>    _head;      // by ID: first live position
+    vector<unsigned>    _tail;      // by ID: last live position
+    size_t              _size;
+};
+
+// Gate-indexed SimBlocks in one array aligned like SimBlock (std::allocator
+// is not, before C++17). Growing keeps the old entries; new ones are 0.
+class CirSimBuf
+{
+public:
+    CirSimBuf(): _buf(0), _size(0), _capacity(0) {}
+    ~CirSimBuf() { free(_buf); }
+
+    void resize(size_t n)
+    {
+        if(n > _capacity)
+        {
+            void* p = 0;
+            if(posix_memalign(&p, sizeof(SimBlock), n * sizeof(SimBlock)))
+                throw bad_alloc();
+            if(_size) memcpy(p, _buf, _size * sizeof(SimBlock));
+            free(_buf);
+            _buf = (SimBlock*)p;
+            _capacity = n;
+        }
+        if(n > _size) memset(_buf + _size, 0, (n - _size) * sizeof(SimBlock));
+        _size = n;
+    }
+    void assign(const CirSimBuf& b)
+    {
+        resize(b._size);
+        if(_size) memcpy(_buf, b._buf, _size * sizeof(SimBlock));
+    }
+    void swap(CirSimBuf& b)
+    {
+        std::swap(_buf, b._buf);
+        std::swap(_size, b._size);
+        std::swap(_capacity, b._capacity);
+    }
+    size_t size() const { return _size; }
+    SimBlock* data() { return _buf; }
+    SimBlock& operator [] (size_t i) { return _buf[i]; }
+    const SimBlock& operator [] (size_t i) const { return _buf[i]; }
+
+private:
+    SimBlock*   _buf;
+    size_t      _size;
+    size_t      _capacity;
+
+    CirSimBuf(const CirSimBuf&);            // non-copyable
+    CirSimBuf& operator = (const CirSimBuf&);
+};
+
+// FEC classes in one flat array: class c holds the literals
+// _lits[_begin[c] .. _end[c]), and classOf()/litOf() give a gate's class
+// (noID if none) and its literal there. refine() splits all classes into a
+// second array and swaps it in, so once both have grown a round allocates
+// nothing. Signatures are whole SimWords, looked up in an open-addressing
+// table sized for the largest class seen.
+class CirFecClasses
+{
+public:
+    void reset(size_t nGates)
+    {
+        _lits.clear();
+        _begin.clear();
+        _end.clear();
+        _classOf.assign(nGates, noID);
+        _litOf.assign(nGates, 0);
+    }
+    void clear() { reset(0); }
+    // append a class; its gates must be in no other class
+    void addClass(const unsigned* b, const unsigned* e)
+    {
+        unsigned c = _begin.size();
+        _begin.push_back(_lits.size());
+        for(; b != e; ++b)
+        {
+            _lits.push_back(*b);
+            _classOf[*b / 2] = c;
+            _litOf[*b / 2] = *b;
+        }
+        _end.push_back(_lits.size());
+    }
+    size_t size() const { return _begin.size(); }
+    bool empty() const { return _begin.empty(); }
+    size_t classSize(unsigned c) const { return _end[c] - _begin[c]; }
+    const unsigned* members(unsigned c) const { return _lits.data() + _begin[c]; }
+    unsigned classOf(unsigned gid) const
+    {
+        return gid < _classOf.size() ? _classOf[gid] : noID;
+    }
+    unsigned litOf(unsigned gid) const { return _litOf[gid]; }
+    void sortClass(unsigned c)
+    {
+        std::sort(_lits.begin() + _begin[c], _lits.begin() + _end[c]);
+    }
+    // take gate gid out of class c; the first member moves into its slot
+    void remove(unsigned c, unsigned gid)
+    {
+        for(unsigned p = _begin[c]; p < _end[c]; ++p)
+            if(_lits[p] / 2 == gid)
+            {
+                _lits[p] = _lits[_begin[c]];
+                ++_begin[c];
+                break;
+            }
+        _classOf[gid] = noID;
+    }
+    // Split each class by key(lit) & mask, members keeping their order;
+    // singletons are dropped. Where a class holds both literals of a gate
+    // (the first one does), the one keyed like an existing subclass or,
+    // failing that, the first is kept. The subclasses come in the order of
+    // their parents, then of their first member.
+    template<class Key>
+    void refine(Key key, SimWord mask)
+    {
+        _newLits.clear();
+        _newBegin.clear();
+        _newEnd.clear();
+        for(size_t c = 0; c < _begin.size(); ++c)
+        {
+            const unsigned b = _begin[c], e = _end[c];
+            reserveSlots(e - b);
+            _subOf.resize(e - b);
+            _subSlot.clear();
+            _subSize.clear();
+            for(unsigned p = b; p < e; ++p)
+                _classOf[_lits[p] / 2] = noID;
+            for(unsigned p = b; p < e; ++p)     // 1: both polarities here
+                _classOf[_lits[p] / 2] = (_classOf[_lits[p] / 2] == noID ? 0 : 1);
+            for(unsigned p = b; p < e; ++p)
+            {
+                unsigned& placed = _classOf[_lits[p] / 2];
+                SimWord k = key(_lits[p]) & mask;
+                unsigned h = slotOf(k), s = _slotSub[h];
+                _subOf[p - b] = noID;
+                if(placed == noID) continue;
+                if(placed == 1 && s == noID && _slotSub[slotOf(~k & mask)] != noID)
+                    continue;
+                if(s == noID)
+                {
+                    s = _slotSub[h] = _subSlot.size();
+                    _slotKey[h] = k;
+                    _subSlot.push_back(h);
+                    _subSize.push_back(0);
+                }
+                placed = noID;                  // the real class comes below
+                _subOf[p - b] = s;
+                ++_subSize[s];
+            }
+            // from here on _subSize[s] is the new class of s, or noID
+            for(size_t s = 0; s < _subSlot.size(); ++s)
+            {
+                _slotSub[_subSlot[s]] = noID;
+                if(_subSize[s] < 2) { _subSize[s] = noID; continue; }
+                unsigned start = _newLits.size();
+                _newLits.resize(start + _subSize[s]);
+                _subSize[s] = _newBegin.size();
+                _newBegin.push_back(start);
+                _newEnd.push_back(start);
+            }
+            for(unsigned p = b; p < e; ++p)
+            {
+                unsigned s = _subOf[p - b], lit = _lits[p];
+                if(s == noID) continue;
+                if(_subSize[s] == noID) { _classOf[lit / 2] = noID; continue; }
+                unsigned n = _subSize[s];
+                _newLits[_newEnd[n]++] = lit;
+                _classOf[lit / 2] = n;
+                _litOf[lit / 2] = lit;
+            }
+        }
+        _lits.swap(_newLits);
+        _begin.swap(_newBegin);
+        _end.swap(_newEnd);
+    }
+
+private:
+    // the table is empty between classes, so it can simply be regrown
+    void reserveSlots(size_t n)
+    {
+        size_t want = 16;
+        while(want < 2 * n) want <<= 1;
+        if(_slotSub.size() >= want) return;
+        _slotSub.assign(want, noID);
+        _slotKey.resize(want);
+    }
+    // k's slot, or the empty one where it would go (linear probing)
+    unsigned slotOf(SimWord k) const
+    {
+        const size_t m = _slotSub.size() - 1;
+        size_t h = size_t((k * 0x9e3779b97f4a7c15ull) >> 32) & m;
+        while(_slotSub[h] != noID && _slotKey[h] != k) h = (h + 1) & m;
+        return h;
+    }
+
+    vector<unsigned>    _lits;
+    vector<unsigned>    _begin;
+    vector<unsigned>    _end;
+    vector<unsigned>    _classOf;   // by gate ID
+    vector<unsigned>    _litOf;     // by gate ID
+    // refine() scratch
+    vector<unsigned>    _newLits;
+    vector<unsigned>    _newBegin;
+    vector<unsigned>    _newEnd;
+    vector<SimWord>     _slotKey;
+    vector<unsigned>    _slotSub;   // by slot: subclass of the current class
+    vector<unsigned>    _subOf;     // by position in the current class
+    vector<unsigned>    _subSlot;
+    vector<unsigned>    _subSize;
+};
+
+class SimPool;                      // cirSim.cpp
+
+struct CirFanoutEdit
+{
+    unsigned    gate;
+    unsigned    fanout;
+    unsigned    prev;           // the gate's previous edit, or noPos
+    bool        add;            // else remove
+};
+
 class CirMgr
 {
     friend class CirGate;
@@ -32,19 +333,18 @@ class CirMgr
     friend class CirPoGate;
     friend class CirAigGate;
 public:
-   CirMgr() {}
-   ~CirMgr() {} 
+   CirMgr(): _dfsDirty(false), _foDirtyCnt(0), _foDead(0), _satCnt(0) {}
+   ~CirMgr() { clearGates(); }
 
    // Access functions
-   // return '0' if "gid" corresponds to an undefined gate.
+   // return '0' if "gid" corresponds to no gate (UNDEF gates are returned).
    CirGate* getGate(unsigned gid) const
     {
-        if(_gateList[gid]) return _gateList[gid];
-        else               return _floGateList[gid];
+        return gid < _gateList.size() ? _gateList[gid] : 0;
     }
 
    // Member functions about circuit construction
-   bool readCircuit(const string&);
+   bool readCircuit(const string&, unsigned nThreads = 1);
     void genDFSList();
 
    // Member functions about circuit optimization
@@ -52,14 +352,20 @@ public:
    void optimize();
 
    // Member functions about simulation
-   void randomSim();
-   void fileSim(ifstream&);
-   void setSimLog(ofstream *logFile) { _simLog = logFile; }
+   void randomSim(unsigned seed, unsigned nThreads = 1, bool byLevels = false, int minGain = -1);
+   void fileSim(const string&, unsigned nThreads = 1);
+   void setSimLog(ofstream *logFile, bool binary = false)
+    { _simLog = logFile; _logBinary = binary; }
+   void setPatternOut(ofstream *patFile) { _patOut = patFile; }
 
    // Member functions about fraig
    void strash();
    void printFEC() const;
-   void fraig();
+   void fraig(unsigned nFlips = 0);
+
+   // Member functions about snapshots
+   bool saveImage(const string&, unsigned state) const;
+   bool loadImage(const string&, unsigned& state);
 
    // Member functions about circuit reporting
    void printSummary() const;
@@ -68,47 +374,195 @@ public:
    void printPOs() const;
    void printFloatGates() const;
    void printFECPairs() const;
+   void printParseStats() const;
+   void printLevels() const;
     void printFanins(unsigned gateID, int curLevel, int level, bool inv);
     void printFanouts(unsigned gateID, int curLevel, int level, unsigned from);
    void writeAag(ostream&) const;
    void writeGate(ostream&, CirGate*) const;
+   void writeAig(ostream&) const;
+   void writeAig(ostream&, CirGate*) const;
 
 private:
    ofstream           *_simLog;
+   bool                _logBinary;   // packed words instead of 0/1 text
+   ofstream           *_patOut;     // packed copy of the file patterns
     static CirGate* const0;
-    mutable map<unsigned, CirGate*> _gateList;
-    mutable map<unsigned, CirGate*> _floGateList; // undef
+    MyArena _gateArena;             // every gate but const0
+    vector<CirGate*> _gateList;     // indexed by gate ID; M + O + 1 entries
+    vector<unsigned char> _gateType;    // GateType of each entry (0: none/UNDEF)
     size_t M, I, L, O, A;
+    bool _binary;                   // reading a binary AIGER (.aig)
+    unsigned _nThreads;             // for the load path
+    size_t _parseBytes;
+    double _parseTime;              // seconds spent scanning the file
     vector<CirGate*> _piList;
     vector<CirGate*> _poList;
-    vector<CirGate*> _aigList;
-    vector<CirGate*> _dfsList;
-    vector<unsigned> _floting;      // with floting fanins
-    vector<unsigned> _unused;
+    vector<CirGate*> _aigList;      // 0 for a gate removed during a pass
+    vector<unsigned> _aigPos;       // by gate ID: index in _aigList
+    vector<CirGate*> _dfsList;      // 0 for a gate merged away during a pass
+    vector<unsigned> _dfsPos;       // by gate ID: index in _dfsList
+    vector<unsigned> _dfsStart;     // by gate ID: _dfsList size when its DFS began
+    bool _dfsDirty;                 // a merge moved more than its own slot
+    CirIdList _floting;             // with floting fanins
+    CirIdList _unused;
+    
+    // The netlist as arrays indexed by gate ID (the type byte is
+    // _gateType); CirGate only views them. The fanins are set as the gates
+    // are read and changed by setFanin(). buildAigStore() derives the
+    // levels and orders whenever _dfsList is rebuilt.
+    vector<unsigned> _fanin0Lit;    // PO/AIG fanin literals, ID * 2 + inv
+    vector<unsigned> _fanin1Lit;
+    map<unsigned, string> _symbols; // PIs and POs that have one
+    // values of the last 64 simulated patterns, 16 to a group with the
+    // newest group lowest (see updateValue()); read by CirGate::reportGate()
+    vector<SimWord>  _value;
+    vector<unsigned> _level;        // PI/CONST 0; AIG 1 + max fanin level
+    vector<unsigned> _topoOrder;    // IDs of _dfsList
+    // _topoOrder bucketed by level: bucket l is _levelOrder[_levelStart[l]
+    // .. _levelStart[l + 1]). Bucket 0 holds the PIs (and CONST) reached,
+    // bucket l in 1..depth the AIGs of level l and the last one the POs,
+    // so no gate depends on another of its own bucket.
+    vector<unsigned> _levelOrder;
+    vector<unsigned> _levelStart;
+    CirSimBuf        _simVal;       // values under the current patterns
+    vector<char>     _simQueued;    // resimulate(): gate is in the event queue
+    vector<int>      _satVar;       // SAT variable, -1 if none
+    
+    // Fanouts in compressed sparse rows: those of gate g are
+    // _foTarget[_foOffset[g] .. _foOffset[g] + _foLen[g]), in connection
+    // order. Edits only go to the _foEdits log (and _foSize), chained per
+    // gate from _foLastEdit; foldFanouts() replays a gate's chain into its
+    // row when the row is read. A row that grows moves to the end of
+    // _foTarget, and the rows are packed again once more than half of it
+    // is dead.
+    mutable vector<unsigned> _foOffset;
+    mutable vector<unsigned> _foLen;        // entries stored in the row
+    mutable vector<unsigned> _foTarget;
+    mutable vector<unsigned> _foSize;       // current fanout count by gate ID
+    mutable vector<unsigned> _foLastEdit;   // by gate ID, noPos if none
+    mutable vector<CirFanoutEdit> _foEdits;
+    mutable size_t           _foDirtyCnt;   // gates with edits in the log
+    mutable size_t           _foDead;       // _foTarget slots in no row
+    mutable CirIdList        _foRow;        // foldFanouts() scratch
+    mutable vector<unsigned> _foChain;
     
+    // like getGate(), but '0' for UNDEF gates as well
+    CirGate* getDefGate(unsigned gid) const
+    {
+        return gid < _gateType.size() && _gateType[gid] != UNDEF_GATE ? _gateList[gid] : 0;
+    }
+    // the gate is still in _dfsList (merged-away slots are 0)
+    bool inDFSList(unsigned gid) const
+    {
+        CirGate* g = getDefGate(gid);
+        return g && _dfsPos[gid] < _dfsList.size() && _dfsList[_dfsPos[gid]] == g;
+    }
+    void setGate(unsigned gid, CirGate* g, GateType t)
+    {
+        _gateList[gid] = g;
+        _gateType[gid] = t;
+    }
+    void setFanin(CirGate* g, size_t i, unsigned lit);
+    void setFanins(unsigned gid, unsigned lit0, unsigned lit1 = 0)
+    {
+        _fanin0Lit[gid] = lit0;
+        _fanin1Lit[gid] = lit1;
+    }
+    const string& getSymbol(unsigned gid) const
+    {
+        static const string none;
+        map<unsigned, string>::const_iterator it = _symbols.find(gid);
+        return it == _symbols.end() ? none : it->second;
+    }
+    unsigned getFanoutNum(unsigned gid) const { return _foSize[gid]; }
+    unsigned getFanout(unsigned gid, size_t i) const
+    {
+        if(_foLastEdit[gid] != noPos) foldFanouts(gid);
+        return _foTarget[_foOffset[gid] + i];
+    }
+    // the row itself, up to date; valid until the next edit or fold
+    unsigned* fanoutRow(unsigned gid) const
+    {
+        if(_foLastEdit[gid] != noPos) foldFanouts(gid);
+        return _foTarget.data() + _foOffset[gid];
+    }
+    void addFanout(unsigned gid, unsigned fanout) { logFanoutEdit(gid, fanout, true); }
+    void removeFanout(unsigned gid, unsigned fanout)
+    {
+        if(!_foSize[gid]) return;
+        logFanoutEdit(gid, fanout, false);
+    }
+    void logFanoutEdit(unsigned gid, unsigned fanout, bool add)
+    {
+        CirFanoutEdit e = { gid, fanout, _foLastEdit[gid], add };
+        if(e.prev == noPos) ++_foDirtyCnt;
+        _foLastEdit[gid] = _foEdits.size();
+        _foEdits.push_back(e);
+        if(add) ++_foSize[gid];
+        else --_foSize[gid];
+    }
+    void fanoutEdits(unsigned gid, unsigned since, vector<unsigned>& chain) const;
+    void layoutFanouts();
+    void foldFanouts(unsigned gid) const;
+    void packFanouts() const;
+    
+    void destroyGate(CirGate* g);
+    void clearGates();
     void reset();
-    bool readHeader(ifstream& inFile);
-    bool readPI(ifstream& inFile);
-    bool readPO(ifstream& inFile);
-    bool readAig(ifstream& inFile);
-    bool readSymbol(ifstream& inFile);
+    bool readHeader();
+    bool readPI();
+    bool readPO();
+    bool readAig();
+    bool readAigParallel();
+    bool readAigBinary();
+    bool readSymbol();
+    
+    void writeAig(ostream&, const vector<CirGate*>& pis,
+                  const vector<CirGate*>& aigs, const vector<unsigned>& poLits,
+                  const vector<CirGate*>& pos) const;
+    
+    void dfs(CirGate* root, vector<CirGate*>& order, vector<unsigned>* start) const;
+    void dropFromDFSList(CirGate* gate, unsigned mgid);
+    void updateDFSList();
+    void dropFromAigList(CirGate* gate);
+    void updateGateLists(bool sorted);
+    void buildAigStore();
+    void connectFanouts();
+    void countFanoutSlice(size_t lo, size_t hi, vector<unsigned>& cnt) const;
+    void connectFanoutSlice(size_t lo, size_t hi, vector<unsigned>& next,
+                            vector<char>& floating);
     
     void removeGate(unsigned gid);
     void replaceByFanin(unsigned gid, unsigned fanin);
 //    void replaceByConst(unsigned gid);
     void merge(CirGate* mgate, CirGate* gate);
     
-    void simulate(string& pattern);
-    mutable queue<vector<unsigned>*> fecPairs;
-    string randomPattern(unsigned I);
-    void genFECPairs();
-    size_t getResults(unsigned n);
-    void deleteDupVec();
-    void deleteSingle();
-    void updateValue();
+    void simulate(CirSimBuf& val, const vector<SimWord>& words, SimPool* pool = 0) const;
+    void resimulate(CirSimBuf& val, const vector<unsigned>& changed);
+    void randomBlock(size_t block, unsigned seed, vector<SimWord>& words) const;
+    void initFECPairs();
+    void beginSimLog();
+    void logPatterns(const CirSimBuf& val, size_t j, size_t sh, size_t n);
+    void endSimLog();
+    string _logBuf;                 // log output not yet written
+    vector<SimWord> _logBlock;      // binary log: the open 64-pattern block
+    size_t _logCnt;
+    mutable CirFecClasses _fecClasses;
+    void genFECPairs(const CirSimBuf& val, size_t j, SimWord mask);
+    void fecStats(size_t& classes, size_t& pairs, size_t& largest) const;
+    void updateValue(const CirSimBuf& val, size_t j, size_t n);
     
     void genProofModel(SatSolver& s);
-    vector<string> SATpatterns;
+    bool addCex(const SatSolver& solver, unsigned nFlips);
+    void flushCex();
+    vector<SimWord> _cexWords;      // fraig(): SAT models not yet simulated,
+    size_t _cexCnt;                 // one bit lane each, by PI
+    size_t _cexFlip;                // next PI flipped for a neighbour
+    // SAT models left for the next random simulation, packed as pattern
+    // files are: I words per 64 patterns, word i holding PI i
+    vector<SimWord> _satWords;
+    size_t _satCnt;
 };
 
 #endif // CIR_MGR_H
@@ -34,20 +34,18 @@ using namespace std;
 void
 CirMgr::sweep()
 {
-    CirGate::_globalRef++;
-//    _dfsList.clear();
-//    for(size_t i = 0; i < _poList.size(); ++i)
-//        _poList[i]->DFS(_gateList, _dfsList);
-    for(size_t i = 0; i < _dfsList.size(); ++i)
-        _dfsList[i]->_ref = CirGate::_globalRef;
+    vector<char> reached(_gateList.size(), 0);
+    for(size_t i = 0; i < _topoOrder.size(); ++i)
+        reached[_topoOrder[i]] = 1;
     
     unsigned cnt = 0;
     CirGate* gate;
     for(unsigned i = I + 1; i <= M; ++i)
     {
-        gate = getGate(i);
-        if(!gate) continue;
-        if(gate->_ref != CirGate::_globalRef)
+        gate = _gateList[i];
+        // PI IDs need not be 1..I, and an unused PI is still a PI
+        if(!gate || _gateType[i] == PI_GATE) continue;
+        if(!reached[i])
         {
             cout << "Sweeping: " << gate->getTypeStr() << "(" << i << ") removed...\n";
             removeGate(i);
@@ -58,10 +56,11 @@ CirMgr::sweep()
         // aigList
     }
     A -= cnt;
+    updateGateLists(false);
 }
 
 // Recursively simplifying from POs;
-// _dfsList needs to be reconstructed afterwards
+// _dfsList is updated afterwards
 // UNDEF gates may be delete if its fanout becomes empty...
 void
 CirMgr::optimize()
@@ -72,54 +71,65 @@ CirMgr::optimize()
     while(removed)
     {
         removed = false;
-        if(const0->_fanout.size())
+        if(getFanoutNum(0))
         {
-            sort(const0->_fanout.begin(), const0->_fanout.end());
-            while(const0->_fanout.size())
+            // replaceByFanin() edits const0's row as we go; follow it in
+            // a CirIdList fed from the edit log instead of re-reading it
+            unsigned* row = fanoutRow(0);
+            sort(row, row + getFanoutNum(0));
+            CirIdList fanouts;
+            fanouts.assign(row, row + getFanoutNum(0));
+            vector<unsigned> edits;
+            for(size_t pos = index; pos < fanouts.slots(); ++pos)
             {
-                if(index >= const0->_fanout.size()) break;
-                if(getGate(const0->_fanout[index])->getTypeStr() == "PO")
+                if(fanouts.isHole(pos)) continue;
+                unsigned gid = fanouts[pos];
+                if(_gateType[gid] == PO_GATE) continue;
+                gate = getGate(gid);
+                unsigned last = _foLastEdit[0];
+                if(gate->getFanin(0) == 0 & gate->getFanin(1) != 0)
                 {
-                    index++;
-                    continue;
-                }
-                gate = getGate(const0->_fanout[index]);
-                if(gate->_fanin0 == 0 & gate->_fanin1 != 0)
-                {
-                    if(gate->_invPhase0)
+                    if(gate->isFaninInv(0))
                     {
-                        replaceByFanin(const0->_fanout[index], gate->_fanin1);
+                        replaceByFanin(gid, gate->getFanin(1));
                     }
                     else
-                        replaceByFanin(const0->_fanout[index], 0);
+                        replaceByFanin(gid, 0);
                 }
-                else if(gate->_fanin1 == 0 & gate->_fanin0 != 0)
+                else if(gate->getFanin(1) == 0 & gate->getFanin(0) != 0)
                 {
-                    if(gate->_invPhase1)
-                        replaceByFanin(const0->_fanout[index], gate->_fanin0);
+                    if(gate->isFaninInv(1))
+                        replaceByFanin(gid, gate->getFanin(0));
                     else
-                        replaceByFanin(const0->_fanout[index], 0);
+                        replaceByFanin(gid, 0);
+                }
+                else if(gate->getFanin(0) == 0 & gate->getFanin(1) == 0)
+                {
+                    replaceByFanin(gid, 0);
                 }
-                else if(gate->_fanin0 == 0 & gate->_fanin1 == 0)
+                fanoutEdits(0, last, edits);
+                for(size_t k = 0; k < edits.size(); ++k)
                 {
-                    replaceByFanin(const0->_fanout[index], 0);
+                    const CirFanoutEdit& edit = _foEdits[edits[k]];
+                    if(edit.add) fanouts.push_back(edit.fanout);
+                    else fanouts.erase(edit.fanout);
                 }
             }
-            removed = true;
-            if(index >= const0->_fanout.size()) removed = false;
+            // the next round starts past everything left here
+            index = fanouts.size();
         }
         
         for(size_t i = 0; i < _dfsList.size(); ++i)
         {
             if(!_dfsList[i]) continue;
-            else if(_dfsList[i]->getTypeStr() == "AIG")
+            else if(_gateType[_dfsList[i]->_gateID] == AIG_GATE)
             {
                 gate = _dfsList[i];
-                if(!(gate->_fanin0 == gate->_fanin1)) continue;
+                if(!(gate->getFanin(0) == gate->getFanin(1))) continue;
                 else
                 {
-                    if(gate->_invPhase0 == gate->_invPhase1)
-                        replaceByFanin(gate->_gateID, gate->_fanin0);
+                    if(gate->isFaninInv(0) == gate->isFaninInv(1))
+                        replaceByFanin(gate->_gateID, gate->getFanin(0));
                     else
                         replaceByFanin(gate->_gateID, 0);
                     removed = true;
@@ -130,9 +140,8 @@ CirMgr::optimize()
     
     // dfs list update
     
-    genDFSList();
-    sort(_floting.begin(), _floting.end());
-    sort(_unused.begin(), _unused.end());
+    updateGateLists(true);
+    updateDFSList();
 }
 
 /***************************************************/
@@ -142,29 +151,18 @@ CirMgr::optimize()
 void
 CirMgr::removeGate(unsigned gid)
 {
-    CirGate* gate = _gateList[gid];
-    if(gate) _gateList.erase(gid);
-    else
-    {
-        gate = _floGateList[gid];
-        _floGateList.erase(gid);
-    }
-    CirGate* fanin0 = _gateList[gate->_fanin0];
-    CirGate* fanin1 = _gateList[gate->_fanin1];
+    CirGate* gate = getGate(gid);
+    // only an AIG still in _aigList is on its fanins' rows; one merged away
+    // by strash or fraig was taken off them already
+    bool connected = (_aigPos[gid] < _aigList.size() && _aigList[_aigPos[gid]] == gate);
+    setGate(gid, 0, UNDEF_GATE);
+    CirGate* fanin0 = getDefGate(gate->getFanin(0));
+    CirGate* fanin1 = getDefGate(gate->getFanin(1));
 //    cout << fanin0->_gateID << " " << fanin1->_gateID;
     if(fanin0)
     {
-        for(vector<unsigned>::iterator it = fanin0->_fanout.begin();
-            it != fanin0->_fanout.end(); ++it)
-        {
-            if(*it == gid)
-            {
-                fanin0->_fanout.erase(it);
-                break;
-            }
-        }
-//        cout << fanin0->_fanout.size() << endl;
-        if(!fanin0->_fanout.size())
+        if(connected) removeFanout(fanin0->_gateID, gid);
+        if(!getFanoutNum(fanin0->_gateID))
         {
 //            cout << gate->_gateID << " " << fanin0->_gateID << endl;
             _unused.push_back(fanin0->_gateID);
@@ -172,194 +170,91 @@ CirMgr::removeGate(unsigned gid)
     }
     if(fanin1)
     {
-        for(vector<unsigned>::iterator it = fanin1->_fanout.begin();
-            it != fanin1->_fanout.end(); ++it)
-        {
-            if(*it == gid)
-            {
-                fanin1->_fanout.erase(it);
-                break;
-            }
-        }
-//        cout << fanin1->_fanout.size() << endl;
-        if(!fanin1->_fanout.size())
+        if(connected) removeFanout(fanin1->_gateID, gid);
+        if(!getFanoutNum(fanin1->_gateID))
         {
 //            cout << gate->_gateID << " " << fanin1->_gateID << endl;
             _unused.push_back(fanin1->_gateID);
         }
     }
     
-    for(vector<CirGate*>::iterator it = _aigList.begin();
-        it != _aigList.end(); ++it)
-    {
-        if(*it == gate)
-        {
-            _aigList.erase(it);
-            break;
-        }
-    }
-    
-    for(vector<unsigned>::iterator it = _floting.begin();
-        it != _floting.end(); ++it)
-    {
-        if(*it == gid)
-        {
-            _floting.erase(it);
-            break;
-        }
-    }
-    
-    for(vector<unsigned>::iterator it = _unused.begin();
-        it != _unused.end(); ++it)
-    {
-        if(*it == gid)
-        {
-            _unused.erase(it);
-            break;
-        }
-    }
+    dropFromAigList(gate);
+    _floting.erase(gid);
+    _unused.erase(gid);
     
-    delete gate;
+    destroyGate(gate);
 }
 
 void
 CirMgr::replaceByFanin(unsigned gid, unsigned fanin)
 {
-    CirGate* gate = _gateList[gid];
-    if(gate) _gateList.erase(gid);
-    else
-    {
-        gate = _floGateList[gid];
-        _floGateList.erase(gid);
-    }
-    CirGate* fanin0 = _gateList[gate->_fanin0];
-    CirGate* fanin1 = _gateList[gate->_fanin1];
-//    cout << gate->_fanin0 << " " << gate->_fanin1 << endl;
+    CirGate* gate = getGate(gid);
+    setGate(gid, 0, UNDEF_GATE);
+    CirGate* fanin0 = getDefGate(gate->getFanin(0));
+    CirGate* fanin1 = getDefGate(gate->getFanin(1));
+//    cout << gate->getFanin(0) << " " << gate->getFanin(1) << endl;
     if(fanin0)
     {
-        for(vector<unsigned>::iterator it = fanin0->_fanout.begin();
-            it != fanin0->_fanout.end(); ++it)
-        {
-            if(*it == gid)
-            {
-                fanin0->_fanout.erase(it);
-                break;
-            }
-        }
-        if(!fanin0->_fanout.size())
+        removeFanout(fanin0->_gateID, gid);
+        if(!getFanoutNum(fanin0->_gateID))
         {
             _unused.push_back(fanin0->_gateID);
         }
     }
     if(fanin1)
     {
-        for(vector<unsigned>::iterator it = fanin1->_fanout.begin();
-            it != fanin1->_fanout.end(); ++it)
-        {
-            if(*it == gid)
-            {
-                fanin1->_fanout.erase(it);
-                break;
-            }
-        }
-        if(!fanin1->_fanout.size())
+        removeFanout(fanin1->_gateID, gid);
+        if(!getFanoutNum(fanin1->_gateID))
         {
             _unused.push_back(fanin1->_gateID);
         }
     }
     
     bool inverse;
-    if(gate->_fanin0 == fanin)
-        inverse = gate->_invPhase0;
+    if(gate->getFanin(0) == fanin)
+        inverse = gate->isFaninInv(0);
     else
-        inverse = gate->_invPhase1;
-    if(gate->_fanin0 == gate->_fanin1)
+        inverse = gate->isFaninInv(1);
+    if(gate->getFanin(0) == gate->getFanin(1))
     {
-        if(gate->_invPhase0 == gate->_invPhase1)
-            inverse = gate->_invPhase0;
+        if(gate->isFaninInv(0) == gate->isFaninInv(1))
+            inverse = gate->isFaninInv(0);
         else
             inverse = false;
     }
     
-    CirGate* merge = getGate(fanin);
+    // one copy of a fanout per edge, so a gate with both fanins on gid
+    // comes up twice and gets both moved
     CirGate* fanouts;
-    for(size_t i = 0; i < gate->_fanout.size(); ++i)
+    vector<unsigned> moved;
+    for(size_t i = 0; i < getFanoutNum(gid); ++i)
     {
-        fanouts = getGate(gate->_fanout[i]);
-//        cout << gate->_fanout[i];
-        if(fanouts->_fanin0 == gid)
-        {
-            fanouts->_fanin0 = fanin;
-            if(inverse)
-                fanouts->_invPhase0 = !fanouts->_invPhase0;
-            if(fanouts->_fanin1 != gid)
-                merge->_fanout.push_back(gate->_fanout[i]);
-            else
-                if(inverse) fanouts->_fanin1 = !fanouts->_fanin1;
-        }
-        else
-        {
-            fanouts->_fanin1 = fanin;
-            if(inverse)
-                fanouts->_invPhase1 = !fanouts->_invPhase1;
-            if(fanouts->_fanin0 != gid)
-                merge->_fanout.push_back(gate->_fanout[i]);
-            else
-                if(inverse) fanouts->_fanin0 = !fanouts->_fanin0;
-        }
+        unsigned fo = getFanout(gid, i);
+        fanouts = getGate(fo);
+//        cout << fo;
+        size_t k = (fanouts->getFanin(0) == gid ? 0 : 1);
+        setFanin(fanouts, k, toLit(fanin, fanouts->isFaninInv(k) != inverse));
+        addFanout(fanin, fo);
+        moved.push_back(fo);
     }
     
-//    cout << getGate(13)->_fanin0 << " " << getGate(13)->_fanin1 << endl;
-//    cout << getGate(13)->_invPhase0 << " " << getGate(13)->_invPhase1 << endl;
+//    cout << getGate(13)->getFanin(0) << " " << getGate(13)->getFanin(1) << endl;
+//    cout << getGate(13)->isFaninInv(0) << " " << getGate(13)->isFaninInv(1) << endl;
     cout << "Simplifying: " << fanin << " merging ";
     if(inverse) cerr << "!";
     cout << gid << "...\n";
     
-//    cout << getGate(11)->_fanin0 << " " << getGate(11)->_fanin1 << endl;
-//    cout << gate->_fanin0 << " " << gate->_fanin1 << endl;
-//    cout << gate->_invPhase0 << " " << gate->_invPhase1 << endl;
-    
-    for(vector<CirGate*>::iterator it = _aigList.begin();
-        it != _aigList.end(); ++it)
-    {
-        if(*it == gate)
-        {
-            _aigList.erase(it);
-            break;
-        }
-    }
-    
-    for(vector<unsigned>::iterator it = _floting.begin();
-        it != _floting.end(); ++it)
-    {
-        if(*it == gid)
-        {
-            _floting.erase(it);
-            break;
-        }
-    }
-    
-    for(vector<unsigned>::iterator it = _unused.begin();
-        it != _unused.end(); ++it)
-    {
-        if(*it == gid)
-        {
-            _unused.erase(it);
-            break;
-        }
-    }
+//    cout << getGate(11)->getFanin(0) << " " << getGate(11)->getFanin(1) << endl;
+//    cout << gate->getFanin(0) << " " << gate->getFanin(1) << endl;
+//    cout << gate->isFaninInv(0) << " " << gate->isFaninInv(1) << endl;
     
-    for(vector<CirGate*>::iterator it = _dfsList.begin();
-        it != _dfsList.end(); ++it)
-    {
-        if(*it == gate)
-        {
-            *it = nullptr;
-            break;
-        }
-    }
+    dropFromAigList(gate);
+    _floting.erase(gid);
+    _unused.erase(gid);
     
-    delete gate;
+    dropFromDFSList(gate, fanin);
+    resimulate(_simVal, moved);
+    destroyGate(gate);
 }
 
 //void
@@ -372,6 +267,6 @@ CirMgr::replaceByFanin(unsigned gid, unsigned fanin)
 //        gate = _floGateList[gid];
 //        _floGateList.erase(gid);
 //    }
-//    CirGate* fanin0 = _gateList[gate->_fanin0];
-//    CirGate* fanin1 = _gateList[gate->_fanin1];
+//    CirGate* fanin0 = _gateList[gate->getFanin(0)];
+//    CirGate* fanin1 = _gateList[gate->getFanin(1)];
 //}
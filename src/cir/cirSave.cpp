@@ -0,0 +1,428 @@
+/****************************************************************************
+  FileName     [ cirSave.cpp ]
+  PackageName  [ cir ]
+  Synopsis     [ Define cir manager snapshot (save/load) functions ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2008-present LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cassert>
+#include "cirMgr.h"
+#include "cirGate.h"
+#include "util.h"
+#include "myFileMap.h"
+
+using namespace std;
+
+// TODO: Keep "CirMgr::saveImage()" and "CirMgr::loadImage()" for cir cmds.
+
+/*******************************/
+/*   Global variable and enum  */
+/*******************************/
+// Image layout (native byte order, every section padded to 8 bytes; a
+// list is its length, padded, then its items):
+//   CirImageHeader
+//   CirGateImage[nGates]            sorted by gate ID
+//   fanouts, symbols                concatenated in gate order
+//   PI, PO, AIG, DFS, floating, unused lists (IDs)
+//   FEC classes
+//   SAT models left by fraig: their count, then I words per 64 of them
+//   PI simulation blocks, simWords words each; the other gates follow
+static const char cirImageMagic[8] = { 'C', 'I', 'R', 'I', 'M', 'G', '\0', '\0' };
+static const unsigned cirImageVersion = 8;
+static const unsigned noIndex = ~0u;
+
+enum CirImageGateType
+{
+    IMG_CONST, IMG_PI, IMG_PO, IMG_AIG, IMG_UNDEF
+};
+
+static const GateType gateTypeOf[] =
+{
+    CONST_GATE, PI_GATE, PO_GATE, AIG_GATE, UNDEF_GATE
+};
+
+// indexed by GateType
+static const CirImageGateType imageTypeOf[TOT_GATE] =
+{
+    IMG_UNDEF, IMG_PI, IMG_PO, IMG_AIG, IMG_CONST
+};
+
+struct CirImageHeader
+{
+    char        magic[8];
+    unsigned    version;
+    unsigned    state;
+    unsigned long long M, I, L, O, A;
+    unsigned    nGates;
+    unsigned    nFecGroups;
+};
+
+struct CirGateImage
+{
+    unsigned    id;
+    unsigned    lineNo;
+    unsigned    fanin0;       // literals
+    unsigned    fanin1;
+    unsigned    nFanout;
+    unsigned    symbolSize;
+    unsigned char type;
+    unsigned char canBeReached;
+    unsigned char pad[6];
+    unsigned long long value;  // the 64 reported value bits, as in _value
+};
+
+/**************************************/
+/*   Static varaibles and functions   */
+/**************************************/
+static void
+putBytes(string& buf, const void* p, size_t n)
+{
+    buf.append((const char*)p, n);
+    buf.append((8 - n % 8) % 8, '\0');
+}
+
+static void
+putList(string& buf, const vector<unsigned>& l)
+{
+    unsigned n = l.size();
+    putBytes(buf, &n, sizeof(n));
+    putBytes(buf, l.data(), n * sizeof(unsigned));
+}
+
+// Reading side: a bounds-checked cursor into the mapped image. Every
+// section starts 8-byte aligned in the mapping, so it is read where it lies.
+static const char *imgCur = 0;
+static const char *imgEnd = 0;
+
+// n items of T at the cursor, or 0 if the image is short
+template<class T>
+static const T*
+viewItems(size_t n)
+{
+    size_t left = imgEnd - imgCur;
+    if(n > left / sizeof(T)) return 0;
+    size_t bytes = n * sizeof(T), padded = bytes + (8 - bytes % 8) % 8;
+    if(left < padded) return 0;
+    const T* p = (const T*)imgCur;
+    imgCur += padded;
+    return p;
+}
+
+static const unsigned*
+viewList(unsigned& n)
+{
+    const unsigned* p = viewItems<unsigned>(1);
+    if(!p) return 0;
+    n = *p;
+    return viewItems<unsigned>(n);
+}
+
+/*******************************************/
+/*   Public member functions about image   */
+/*******************************************/
+// "state" is the command state of the caller; it is returned by loadImage()
+bool
+CirMgr::saveImage(const string& fileName, unsigned state) const
+{
+    ofstream outFile(fileName.c_str(), ios::out | ios::binary);
+    if(!outFile) return false;
+
+    vector<CirGate*> gates;
+    for(size_t i = 0; i < _gateList.size(); ++i)
+        if(_gateList[i]) gates.push_back(_gateList[i]);
+
+    // FEC classes as their member literals
+    vector<vector<unsigned> > groups(_fecClasses.size());
+    for(unsigned c = 0; c < groups.size(); ++c)
+    {
+        const unsigned* v = _fecClasses.members(c);
+        groups[c].assign(v, v + _fecClasses.classSize(c));
+    }
+
+    CirImageHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, cirImageMagic, sizeof(header.magic));
+    header.version = cirImageVersion;
+    header.state = state;
+    header.M = M; header.I = I; header.L = L; header.O = O; header.A = A;
+    header.nGates = gates.size();
+    header.nFecGroups = groups.size();
+
+    vector<CirGateImage> records(gates.size());
+    vector<unsigned> fanouts;
+    string symbols;
+    for(size_t i = 0; i < gates.size(); ++i)
+    {
+        CirGate* g = gates[i];
+        CirGateImage& r = records[i];
+        memset(&r, 0, sizeof(r));
+        r.id = g->_gateID;
+        r.type = imageTypeOf[_gateType[r.id]];
+        r.lineNo = g->_lineNo;
+        r.fanin0 = g->getFaninLit(0);
+        r.fanin1 = g->getFaninLit(1);
+        r.canBeReached = g->_canBeReached;
+        r.nFanout = getFanoutNum(r.id);
+        r.symbolSize = g->getSymbol().size();
+        r.value = _value[r.id];
+        for(unsigned k = 0; k < r.nFanout; ++k)
+            fanouts.push_back(getFanout(r.id, k));
+        symbols += g->getSymbol();
+    }
+
+    vector<unsigned> ids;
+    string buf;
+    putBytes(buf, &header, sizeof(header));
+    putBytes(buf, records.data(), records.size() * sizeof(CirGateImage));
+    putList(buf, fanouts);
+    putBytes(buf, symbols.data(), symbols.size());
+    const vector<CirGate*>* lists[] = { &_piList, &_poList, &_aigList, &_dfsList };
+    for(size_t k = 0; k < 4; ++k)
+    {
+        ids.clear();
+        for(size_t i = 0; i < lists[k]->size(); ++i)
+            ids.push_back((*lists[k])[i] ? (*lists[k])[i]->_gateID : noIndex);
+        putList(buf, ids);
+    }
+    const CirIdList* idLists[] = { &_floting, &_unused };
+    for(size_t k = 0; k < 2; ++k)
+    {
+        ids.clear();
+        idLists[k]->appendTo(ids);
+        putList(buf, ids);
+    }
+    for(size_t i = 0; i < groups.size(); ++i)
+        putList(buf, groups[i]);
+    ids.assign(1, _satCnt);
+    putList(buf, ids);
+    putBytes(buf, _satWords.data(), _satWords.size() * sizeof(SimWord));
+    for(size_t i = 0; i < _piList.size(); ++i)
+    {
+        unsigned id = _piList[i]->_gateID;
+        SimBlock b = (id < _simVal.size() ? _simVal[id] : SimBlock());
+        putBytes(buf, b.w, sizeof(b.w));
+    }
+
+    outFile.write(buf.data(), buf.size());
+    return (bool)outFile;
+}
+
+// The image is mapped read-only and its sections are read in place: the
+// records, lists and words go from the mapping straight into the arrays
+// of a fresh manager, with no copy in between. Only the gate objects and
+// the signatures, simulated again from the saved PI blocks, are rebuilt.
+bool
+CirMgr::loadImage(const string& fileName, unsigned& state)
+{
+    MyFileMap image;
+    if(!image.open(fileName))
+    {
+        cerr << "Cannot open image \"" << fileName << "\"!!\n";
+        return false;
+    }
+    reset();
+    imgCur = image.begin();
+    imgEnd = image.end();
+
+    const CirImageHeader* header = viewItems<CirImageHeader>(1);
+    if(!header ||
+       memcmp(header->magic, cirImageMagic, sizeof(header->magic)) != 0 ||
+       header->version != cirImageVersion ||
+       header->M >= noIndex || header->O >= noIndex - header->M ||
+       header->I > header->M || header->nGates > header->M + header->O + 1)
+    {
+        cerr << "Error: \"" << fileName << "\" is not a circuit image!!\n";
+        imgCur = imgEnd = 0;
+        return false;
+    }
+    state = header->state;
+    M = header->M; I = header->I; L = header->L; O = header->O; A = header->A;
+    _gateList.assign(M + O + 1, 0);
+    _gateType.assign(M + O + 1, UNDEF_GATE);
+    _fanin0Lit.assign(M + O + 1, 0);
+    _fanin1Lit.assign(M + O + 1, 0);
+    _value.assign(M + O + 1, 0);
+
+    const CirGateImage* records = viewItems<CirGateImage>(header->nGates);
+    unsigned nFanout = 0;
+    const unsigned* fanouts = (records ? viewList(nFanout) : 0);
+    bool ok = fanouts;
+    size_t nSymbol = 0, nFanoutSum = 0;
+    for(size_t i = 0; ok && i < header->nGates; ++i)
+    {
+        nSymbol += records[i].symbolSize;
+        nFanoutSum += records[i].nFanout;
+    }
+    ok = ok && nFanoutSum == nFanout;
+    const char* symbols = (ok ? viewItems<char>(nSymbol) : 0);
+    ok = symbols;
+
+    const unsigned* lists[6];
+    unsigned listSize[6];
+    for(size_t k = 0; ok && k < 6; ++k)
+        ok = (lists[k] = viewList(listSize[k]));
+    // the FEC classes are added after the gates
+    const char* groupsAt = imgCur;
+    for(size_t i = 0; ok && i < header->nFecGroups; ++i)
+    {
+        unsigned n;
+        ok = viewList(n);
+    }
+    unsigned nSat = 0, one = 0;
+    const unsigned* satCnt = (ok ? viewList(one) : 0);
+    if(satCnt && one == 1) nSat = *satCnt;
+    else satCnt = 0;
+    const SimWord* satWords = (satCnt ? viewItems<SimWord>((size_t(nSat) + 63) / 64 * I) : 0);
+    const SimWord* piWords = (satWords ? viewItems<SimWord>(I * simWords) : 0);
+    if(!piWords)
+    {
+        cerr << "Error: circuit image \"" << fileName << "\" is truncated!!\n";
+        imgCur = imgEnd = 0;
+        return false;
+    }
+
+    // Every ID the decoding below goes by must name a saved gate: the
+    // lists, the FEC class members and the fanouts of the gates in use.
+    // A fanin may also name a gate swept away, or one past the last gate
+    // (an UNDEF gate's).
+    vector<unsigned> recOf(M + O + 1, noIndex);
+    for(size_t i = 0; ok && i < header->nGates; ++i)
+    {
+        const CirGateImage& r = records[i];
+        ok = r.id <= M + O && r.type <= IMG_UNDEF && recOf[r.id] == noIndex &&
+             (r.type == IMG_CONST) == (r.id == 0) &&
+             r.fanin0 / 2 <= M + O + 1 && r.fanin1 / 2 <= M + O + 1;
+        if(ok) recOf[r.id] = i;
+    }
+    auto isGate = [&](size_t id) { return id <= M + O && recOf[id] != noIndex; };
+    auto typeOf = [&](size_t id) { return records[recOf[id]].type; };
+    // the PIs, POs and AIGs by type, with no holes, as a command leaves
+    // them; the floating and unused lists, which are only printed, may
+    // still hold a gate swept away
+    ok = ok && listSize[0] == I && listSize[1] == O;
+    for(size_t k = 0; ok && k < 6; ++k)
+        for(size_t i = 0; ok && i < listSize[k]; ++i)
+        {
+            unsigned id = lists[k][i];
+            ok = (k >= 4 && id <= M + O) ||
+                 (isGate(id) && (k != 0 || typeOf(id) == IMG_PI) &&
+                  (k != 1 || typeOf(id) == IMG_PO) && (k != 2 || typeOf(id) == IMG_AIG));
+        }
+    // A gate's fanouts are the edges into it from the POs and the AIGs
+    // still listed, so a damaged edge cannot slip in on one side only. An
+    // AIG merged away keeps a stale row, which is never read again; its
+    // fanouts need only be in range.
+    vector<unsigned> edges(ok ? M + O + 2 : 0, 0);
+    vector<bool> listed(edges.size(), false);
+    for(size_t k = 1; ok && k < 3; ++k)
+        for(size_t i = 0; i < listSize[k]; ++i)
+        {
+            const CirGateImage& r = records[recOf[lists[k][i]]];
+            listed[r.id] = true;
+            ++edges[r.fanin0 / 2];
+            if(r.type == IMG_AIG) ++edges[r.fanin1 / 2];
+        }
+    for(size_t i = 0, fo = 0; ok && i < header->nGates; fo += records[i++].nFanout)
+    {
+        const CirGateImage& r = records[i];
+        if(r.type == IMG_AIG && !listed[r.id])
+        {
+            for(unsigned k = 0; ok && k < r.nFanout; ++k)
+                ok = fanouts[fo + k] <= M + O;
+            continue;
+        }
+        ok = edges[r.id] == r.nFanout;
+        for(unsigned k = 0; ok && k < r.nFanout; ++k)
+        {
+            ok = isGate(fanouts[fo + k]);
+            if(!ok) break;
+            const CirGateImage& t = records[recOf[fanouts[fo + k]]];
+            ok = (t.type == IMG_PO || t.type == IMG_AIG) &&
+                 (t.fanin0 / 2 == r.id || (t.type == IMG_AIG && t.fanin1 / 2 == r.id));
+        }
+    }
+    imgCur = groupsAt;
+    for(size_t i = 0; ok && i < header->nFecGroups; ++i)
+    {
+        unsigned n;
+        const unsigned* v = viewList(n);
+        for(size_t j = 0; ok && j < n; ++j)
+            ok = isGate(v[j] / 2);
+    }
+    if(!ok)
+    {
+        cerr << "Error: \"" << fileName << "\" is not a circuit image!!\n";
+        imgCur = imgEnd = 0;
+        return false;
+    }
+
+    // gates
+    size_t sym = 0;
+    for(size_t i = 0; i < header->nGates; ++i)
+    {
+        const CirGateImage& r = records[i];
+        CirGate* g;
+        switch(r.type)
+        {
+            case IMG_CONST: g = const0; break;
+            case IMG_PI:    g = new (_gateArena) CirPiGate(r.id, r.lineNo); break;
+            case IMG_PO:    g = new (_gateArena) CirPoGate(r.id, r.lineNo); break;
+            case IMG_AIG:   g = new (_gateArena) CirAigGate(r.id, r.lineNo); break;
+            default:        g = new (_gateArena) CirUndefGate(r.id); break;
+        }
+        g->_lineNo = r.lineNo;
+        g->_canBeReached = r.canBeReached;
+        setFanins(r.id, r.fanin0, r.fanin1);
+        if(r.symbolSize)
+            _symbols[r.id] = string(symbols + sym, r.symbolSize);
+        _value[r.id] = r.value;
+        sym += r.symbolSize;
+        setGate(r.id, g, gateTypeOf[r.type]);
+    }
+    // fanouts, back into rows by gate ID
+    _foSize.assign(M + O + 1, 0);
+    for(size_t i = 0; i < header->nGates; ++i)
+        _foSize[records[i].id] += records[i].nFanout;
+    layoutFanouts();
+    for(size_t i = 0, fo = 0; i < header->nGates; fo += records[i++].nFanout)
+        copy(fanouts + fo, fanouts + fo + records[i].nFanout,
+             _foTarget.begin() + _foOffset[records[i].id]);
+    // lists
+    vector<CirGate*>* gateLists[] = { &_piList, &_poList, &_aigList, &_dfsList };
+    for(size_t k = 0; k < 4; ++k)
+    {
+        gateLists[k]->reserve(listSize[k]);
+        for(size_t i = 0; i < listSize[k]; ++i)
+            gateLists[k]->push_back(getGate(lists[k][i]));
+    }
+    // where each gate's DFS began is not saved, so the next pass rebuilds
+    _dfsPos.assign(M + O + 1, 0);
+    _dfsStart.assign(M + O + 1, 0);
+    for(size_t i = 0; i < _dfsList.size(); ++i)
+        if(_dfsList[i]) _dfsPos[_dfsList[i]->_gateID] = i;
+    _dfsDirty = true;
+    _floting.assign(lists[4], lists[4] + listSize[4]);
+    _unused.assign(lists[5], lists[5] + listSize[5]);
+    updateGateLists(false);
+    // a gate's class and literal follow from the members
+    _fecClasses.reset(M + O + 1);
+    imgCur = groupsAt;
+    for(size_t i = 0; i < header->nFecGroups; ++i)
+    {
+        unsigned n;
+        const unsigned* v = viewList(n);
+        _fecClasses.addClass(v, v + n);
+    }
+    imgCur = imgEnd = 0;
+    _satWords.assign(satWords, satWords + (size_t(nSat) + 63) / 64 * I);
+    _satCnt = nSat;
+    buildAigStore();
+    // the signatures, as the FEC classes and a later fraig see them
+    simulate(_simVal, vector<SimWord>(piWords, piWords + I * simWords));
+
+    return true;
+}
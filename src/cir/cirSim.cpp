@@ -11,219 +11,510 @@
 #include <iomanip>
 #include <algorithm>
 #include <cassert>
+#include <cctype>
 #include <cmath>
+#include <cstring>
+#include <ctime>
 #include <string>
-#include <unordered_map>
 #include <queue>
+#include <thread>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
 #include "cirMgr.h"
 #include "cirGate.h"
 #include "util.h"
-
-#define bigP 27644437
+#include "myFileMap.h"
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#endif
 
 using namespace std;
 
-static unsigned r;
-
 // TODO: Keep "CirMgr::randimSim()" and "CirMgr::fileSim()" for cir cmd.
 //       Feel free to define your own variables or functions
 
 /*******************************/
 /*   Global variable and enum  */
 /*******************************/
+// Packed pattern file (native byte order): a CirPatHeader, then one block
+// of I words per 64 patterns.  Bit k of word i in a block is PI i of the
+// k-th pattern of that block; the unused bits of the last block are 0.
+static const char cirPatMagic[8] = { 'C', 'I', 'R', 'P', 'A', 'T', '\0', '\0' };
+static const unsigned cirPatVersion = 1;
 
-string
-toBinary(size_t num, unsigned I)
+struct CirPatHeader
 {
-    string pattern = "";         // const 0
-    for(size_t i = 0; i < I; ++i)
-        pattern += "0";
-    int n = I - 1, m;
-    while(n >= 0)
+    char        magic[8];
+    unsigned    version;
+    unsigned    nInputs;
+    unsigned long long nPatterns;
+};
+
+// Binary simulation log: a CirLogHeader, then one block of I PI words and
+// O PO words per 64 patterns, bit k being the k-th pattern of the block.
+// The text log has one "<PI values> <PO values>" line per pattern.
+static const char cirLogMagic[8] = { 'C', 'I', 'R', 'S', 'L', 'O', 'G', '\0' };
+static const unsigned cirLogVersion = 1;
+static const size_t logFlushSize = 1 << 20;
+
+struct CirLogHeader
+{
+    char        magic[8];
+    unsigned    version;
+    unsigned    nInputs;
+    unsigned    nOutputs;
+    unsigned    pad;
+    unsigned long long nPatterns;
+};
+
+/**************************************/
+/*   Static varaibles and functions   */
+/**************************************/
+// Read up to 64 text patterns from [p, end) into "words"; returns how many
+// were read.  A malformed pattern is reported and stops the reading.
+static size_t
+parsePatterns(const char*& p, const char* end, size_t I,
+              vector<SimWord>& words, bool& error)
+{
+    fill(words.begin(), words.end(), 0);
+    size_t n = 0;
+    for(; n < 64; ++n)
     {
-        m = pow(2, n);
-        if(num >= m)
+        while(p != end && isspace(*p)) ++p;
+        if(p == end) break;
+        const char* tok = p;
+        while(p != end && !isspace(*p)) ++p;
+        size_t len = p - tok;
+        if(len != I)
         {
-            num -= m;
-            pattern[I - n - 1] = '1';
+            cout << "\nError: Pattern(" << string(tok, len) << ") length(" << len << ") does not match the number of inputs(" << I << ") in a circuit!!\n";
+            error = true;
+            break;
+        }
+        for(size_t i = 0; i < I; ++i)
+        {
+            if(tok[i] == '1') words[i] |= SimWord(1) << n;
+            else if(tok[i] != '0')
+            {
+                cout << "\nError: Pattern(" << string(tok, len) << ") contains a non-0/1 character('" << tok[i] << "').\n";
+                error = true;
+                return n;
+            }
         }
-        n--;
     }
-    return pattern;
+    return n;
 }
 
-size_t toDecimal(string& pattern)
+// Simulation kernels: val[id] = fanin0 & fanin1 for the AIGs order[0, n),
+// complements applied, one whole SimBlock per gate. The AVX ones are
+// compiled for their own target only; simKernel is picked at start-up
+// from what the CPU supports.
+typedef void (*SimKernel)(SimBlock* val, const unsigned* order, size_t n,
+                          const unsigned* fanin0, const unsigned* fanin1);
+static_assert(simWords % 8 == 0, "the AVX kernels take 8 words at a time");
+
+static void
+simKernelScalar(SimBlock* val, const unsigned* order, size_t n,
+                const unsigned* fanin0, const unsigned* fanin1)
 {
-    size_t num = 0;
-    for(size_t i = 0; i < pattern.size(); ++i)
-        if(pattern[i] == '1')
-            num += pow(2, pattern.size() - 1 - i);
-    return num;
+    for(size_t i = 0; i < n; ++i)
+    {
+        unsigned id = order[i], l0 = fanin0[id], l1 = fanin1[id];
+        const SimWord* a = val[litID(l0)].w;
+        const SimWord* b = val[litID(l1)].w;
+        SimWord m0 = -SimWord(litInv(l0)), m1 = -SimWord(litInv(l1));
+        for(size_t k = 0; k < simWords; ++k)
+            val[id].w[k] = (a[k] ^ m0) & (b[k] ^ m1);
+    }
 }
 
-string
-CirMgr::randomPattern(unsigned I)
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CIR_SIM_X86
+
+__attribute__((target("avx2")))
+static void
+simKernelAvx2(SimBlock* val, const unsigned* order, size_t n,
+              const unsigned* fanin0, const unsigned* fanin1)
 {
-    string pattern = "";
-    if(SATpatterns.size())
+    for(size_t i = 0; i < n; ++i)
     {
-        pattern = SATpatterns[0];
-        SATpatterns.erase(SATpatterns.begin());
-        return pattern;
+        unsigned id = order[i], l0 = fanin0[id], l1 = fanin1[id];
+        const SimWord* a = val[litID(l0)].w;
+        const SimWord* b = val[litID(l1)].w;
+        __m256i m0 = _mm256_set1_epi64x(-(long long)litInv(l0));
+        __m256i m1 = _mm256_set1_epi64x(-(long long)litInv(l1));
+        for(size_t k = 0; k < simWords; k += 4)
+        {
+            __m256i x = _mm256_xor_si256(_mm256_load_si256((const __m256i*)(a + k)), m0);
+            __m256i y = _mm256_xor_si256(_mm256_load_si256((const __m256i*)(b + k)), m1);
+            _mm256_store_si256((__m256i*)(val[id].w + k), _mm256_and_si256(x, y));
+        }
     }
-    size_t t = pow(2, 16);
-    while(I > 16)
+}
+
+__attribute__((target("avx512f")))
+static void
+simKernelAvx512(SimBlock* val, const unsigned* order, size_t n,
+                const unsigned* fanin0, const unsigned* fanin1)
+{
+    for(size_t i = 0; i < n; ++i)
     {
-        pattern += toBinary(r % t, 16);
-        r += bigP;
-        I -= 16;
+        unsigned id = order[i], l0 = fanin0[id], l1 = fanin1[id];
+        const SimWord* a = val[litID(l0)].w;
+        const SimWord* b = val[litID(l1)].w;
+        __m512i m0 = _mm512_set1_epi64(-(long long)litInv(l0));
+        __m512i m1 = _mm512_set1_epi64(-(long long)litInv(l1));
+        for(size_t k = 0; k < simWords; k += 8)
+        {
+            __m512i x = _mm512_xor_si512(_mm512_load_si512(a + k), m0);
+            __m512i y = _mm512_xor_si512(_mm512_load_si512(b + k), m1);
+            _mm512_store_si512(val[id].w + k, _mm512_and_si512(x, y));
+        }
     }
-    pattern += toBinary(r % (long)pow(2, I), I);
-    r += bigP;
-    return pattern;
 }
+#endif
 
-/**************************************/
-/*   Static varaibles and functions   */
-/**************************************/
+static SimKernel
+pickSimKernel()
+{
+#ifdef CIR_SIM_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f")) return simKernelAvx512;
+    if(__builtin_cpu_supports("avx2")) return simKernelAvx2;
+#endif
+    return simKernelScalar;
+}
 
-/************************************************/
-/*   Public member functions about Simulation   */
-/************************************************/
-void
-CirMgr::randomSim()
+static const SimKernel simKernel = pickSimKernel();
+
+// val[id] = fanin0 for the POs order[0, n)
+static void
+simPOs(SimBlock* val, const unsigned* order, size_t n, const unsigned* fanin0)
+{
+    for(size_t i = 0; i < n; ++i)
+    {
+        unsigned id = order[i], l0 = fanin0[id];
+        for(size_t k = 0; k < simWords; ++k)
+            val[id].w[k] = val[litID(l0)].w[k] ^ -SimWord(litInv(l0));
+    }
+}
+
+// Level-parallel simulation: a thread takes at least this many gates of a
+// level, so that narrow levels do not cost every thread a wake-up
+static const size_t simChunkMin = 256;
+
+// All nThreads threads return from wait() once the last one has called it
+class SimBarrier
 {
-    r = rand();
-    if(fecPairs.empty())
+public:
+    SimBarrier(unsigned n): _n(n), _waiting(0), _phase(0) {}
+    void wait()
     {
-        vector<unsigned>* v = new vector<unsigned>;
-        v->push_back(0);
-        v->push_back(1);
-        for(size_t i = 0; i < _dfsList.size(); ++i)
+        unique_lock<mutex> lock(_mutex);
+        unsigned phase = _phase;
+        if(++_waiting == _n)
         {
-            if(_dfsList[i]->getTypeStr() != "AIG") continue;
-            v->push_back(_dfsList[i]->_gateID * 2);
-            v->push_back(_dfsList[i]->_gateID * 2 + 1);
+            _waiting = 0;
+            ++_phase;
+            _cond.notify_all();
         }
-        fecPairs.push(v);
+        else
+            _cond.wait(lock, [&]() { return _phase != phase; });
     }
+
+private:
+    mutex               _mutex;
+    condition_variable  _cond;
+    unsigned            _n;
+    unsigned            _waiting;
+    unsigned            _phase;
+};
+
+// Threads for one simulation command: the caller is thread 0 and the
+// other size() - 1 are started once, then wait between jobs. run(f) has
+// every thread call f(t) and returns when all of them are done.
+class SimPool
+{
+public:
+    SimPool(unsigned n): _n(n), _start(n), _done(n), _job(0), _quit(false)
+    {
+        for(unsigned t = 1; t < n; ++t)
+            _workers.push_back(thread([this, t]() {
+                for(;;)
+                {
+                    _start.wait();
+                    if(_quit) return;
+                    (*_job)(t);
+                    _done.wait();
+                }
+            }));
+    }
+    ~SimPool()
+    {
+        if(_workers.empty()) return;
+        _quit = true;
+        _start.wait();
+        for(size_t t = 0; t < _workers.size(); ++t) _workers[t].join();
+    }
+    unsigned size() const { return _n; }
+    void run(const function<void(unsigned)>& f)
+    {
+        if(_n == 1)
+        {
+            f(0);
+            return;
+        }
+        _job = &f;
+        _start.wait();
+        f(0);
+        _done.wait();
+    }
+
+private:
+    unsigned            _n;
+    SimBarrier          _start;
+    SimBarrier          _done;
+    const function<void(unsigned)>* _job;
+    bool                _quit;          // read after _start, like _job
+    vector<thread>      _workers;
+
+    SimPool(const SimPool&);                // non-copyable
+    SimPool& operator = (const SimPool&);
+};
+
+// xoshiro256** (Blackman and Vigna) seeded through splitmix64. Each random
+// block has a generator of its own, seeded from (seed, block), so any
+// block can be filled first and by any worker.
+class SimRng
+{
+public:
+    SimRng(SimWord seed) { for(size_t i = 0; i < 4; ++i) _s[i] = splitMix64(seed); }
+    SimWord operator () ()
+    {
+        SimWord r = rotl(_s[1] * 5, 7) * 9, t = _s[1] << 17;
+        _s[2] ^= _s[0];
+        _s[3] ^= _s[1];
+        _s[1] ^= _s[2];
+        _s[0] ^= _s[3];
+        _s[2] ^= t;
+        _s[3] = rotl(_s[3], 45);
+        return r;
+    }
+
+private:
+    static SimWord splitMix64(SimWord& x)
+    {
+        SimWord z = (x += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+    static SimWord rotl(SimWord x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    SimWord _s[4];
+};
+
+static void
+writePatterns(ostream& os, size_t I, const string& blocks, size_t nPatterns)
+{
+    CirPatHeader h;
+    memcpy(h.magic, cirPatMagic, sizeof(h.magic));
+    h.version = cirPatVersion;
+    h.nInputs = I;
+    h.nPatterns = nPatterns;
+    os.write((const char*)&h, sizeof(h));
+    os.write(blocks.data(), blocks.size());
+}
+
+/************************************************/
+/*   Public member functions about Simulation   */
+/************************************************/
+// Patterns come in blocks of 64 * simWords: the SAT models left by fraig
+// first, then the random stream. With
+// nThreads > 1 each worker simulates one block into its own buffer, and
+// the blocks are then taken in order, just as one thread would, with the
+// stop test every 64 patterns; the blocks past the stop are dropped. The output is thus the
+// same for any nThreads.
+// With "byLevels", one block is simulated at a time with its levels split
+// across nThreads (see simulate()), which wins on very wide circuits.
+// Either way the threads are started once, for the whole run.
+// The same seed gives the same patterns, whatever nThreads and byLevels.
+// With minGain > 0 the fixed stop test gives way to an adaptive one: each
+// batch of blocks is simulated in full, and the run stops once a batch
+// removes fewer than minGain candidate pairs per CPU-second (or none are
+// left). One trace line is printed per batch. The stop point then depends
+// on the machine, not only on the seed. Either way no more than 4 * M
+// patterns are simulated, rounded up to a whole word.
+void
+CirMgr::randomSim(unsigned seed, unsigned nThreads, bool byLevels, int minGain)
+{
+    SimPool pool(nThreads);
+    if(byLevels) nThreads = 1;
+    initFECPairs();
+    beginSimLog();
+    const bool adaptive = (minGain > 0);
+    bool converged = false;
+    size_t classes = 0, pairs = 0, largest = 0;
+    if(adaptive) fecStats(classes, pairs, largest);
+    clock_t tick = clock();
     
 //    size_t maxUnsigned = pow(2, I);
-    string pattern;
+    vector<CirSimBuf> bufs(nThreads);
+    vector<vector<SimWord> > words(nThreads, vector<SimWord>(I * simWords));
+    for(unsigned k = 0; k < nThreads; ++k)
+        bufs[k].assign(_simVal);    // unreachable gates keep their values
 //    size_t results;
     size_t oldPairs = 0;
     size_t noNewPairGen = 0;
     size_t cnt = 0;
-    string v1, v2;
-    while(noNewPairGen < 30 & cnt < 4 * M)
+    size_t block = 0;
+    unsigned last = nThreads;
+    // fixed stop: 8 words in all that leave the class count as it was
+    auto more = [&]() { return (adaptive ? !converged : noNewPairGen < 8) && cnt < 4 * M; };
+    while(more())
     {
-//        for(size_t i = 0; i < A; ++i)
-//            _aigList[i]->_simResults = 0;
-
-        for(size_t th = 0; th < 4; ++th)
+        auto work = [&](unsigned k) {
+            randomBlock(block + k, seed, words[k]);
+            simulate(bufs[k], words[k], byLevels ? &pool : 0);
+        };
+        if(nThreads == 1) work(0);
+        else pool.run(work);
+        for(unsigned k = 0; k < nThreads && more(); ++k)
         {
-            for(size_t i = 0; i < _aigList.size(); ++i)
-                _aigList[i]->_simResults = 0;
-            
-            for(size_t i = 0; i < 16; ++i)
+            for(size_t j = 0; j < simWords && more(); ++j)
             {
-                pattern = randomPattern(I);
-                simulate(pattern);
-                for(size_t j = 0; j < _aigList.size(); ++j)
-                    if(_aigList[j]->_sim)
-                        _aigList[j]->_simResults += (1 << i);
-                for(size_t j = 0; j < _piList.size(); ++j)
-                    if(_piList[j]->_sim)
-                        _piList[j]->_simResults += (1 << i);
-                for(size_t j = 0; j < _poList.size(); ++j)
-                    if(_poList[j]->_sim)
-                        _poList[j]->_simResults += (1 << i);
-                cnt++;
+                cnt += 64;
+                logPatterns(bufs[k], j, 0, 64);
+                updateValue(bufs[k], j, 64);
+                oldPairs = _fecClasses.size();
+                genFECPairs(bufs[k], j, ~SimWord(0));
+                if(oldPairs == _fecClasses.size()) noNewPairGen++;
             }
-            updateValue();
-            oldPairs = fecPairs.size();
-            genFECPairs();
-            if(oldPairs == fecPairs.size()) noNewPairGen++;
+            last = k;
+        }
+        block += nThreads;
+        if(adaptive)
+        {
+            size_t lastPairs = pairs;
+            fecStats(classes, pairs, largest);
+            clock_t now = clock();
+            double sec = double(now - tick) / CLOCKS_PER_SEC;
+            tick = now;
+            double gain = (lastPairs - pairs) / (sec > 0 ? sec : 1.0 / CLOCKS_PER_SEC);
+            cout << setw(10) << cnt << " patterns: " << classes << " classes, "
+                 << pairs << " pairs, largest " << largest << ", "
+                 << size_t(gain) << " pairs/s\n";
+            converged = (!pairs || gain < minGain);
         }
 //        cerr << noNewPairGen << endl;
 //        cerr << cnt << endl;
     }
+    if(last < nThreads) _simVal.swap(bufs[last]);
+    // the SAT models simulated are used up; cnt is a whole number of words
+    if(cnt >= _satCnt)
+    {
+        _satWords.clear();
+        _satCnt = 0;
+    }
+    else
+    {
+        _satWords.erase(_satWords.begin(), _satWords.begin() + cnt / 64 * I);
+        _satCnt -= cnt;
+    }
+    endSimLog();
     cout << cnt << " patterns simulated.\n";
 }
 
+// A pattern file is either text (one 0/1 string per pattern) or packed
+// (see CirPatHeader); both are mapped and handed to the simulator in
+// blocks of 64 patterns.  With a pattern output set, the patterns are also
+// written there in the packed format. nThreads splits each level, as in
+// simulate(); the threads serve every block of the file.
 void
-CirMgr::fileSim(ifstream& patternFile)
+CirMgr::fileSim(const string& fileName, unsigned nThreads)
 {
-    if(fecPairs.empty())
+    MyFileMap patternFile;
+    if(!patternFile.open(fileName))
     {
-        vector<unsigned>* v = new vector<unsigned>;
-        v->push_back(0);
-        v->push_back(1);
-        for(size_t i = 0; i < _dfsList.size(); ++i)
+        cerr << "Cannot open pattern file \"" << fileName << "\"!!\n";
+        return;
+    }
+    const char* p = patternFile.begin();
+    const char* end = patternFile.end();
+    const SimWord* packed = 0;
+    size_t nPacked = 0;
+    if(patternFile.size() >= sizeof(CirPatHeader)
+       && memcmp(p, cirPatMagic, sizeof(cirPatMagic)) == 0)
+    {
+        CirPatHeader h;
+        memcpy(&h, p, sizeof(h));
+        size_t nWords = (h.nPatterns + 63) / 64 * h.nInputs;
+        if(h.version != cirPatVersion
+           || (patternFile.size() - sizeof(h)) / sizeof(SimWord) < nWords)
+        {
+            cerr << "Error: \"" << fileName << "\" is not a valid packed pattern file!!\n";
+            return;
+        }
+        if(h.nInputs != I)
         {
-            if(_dfsList[i]->getTypeStr() != "AIG") continue;
-            v->push_back(_dfsList[i]->_gateID * 2);
-            v->push_back(_dfsList[i]->_gateID * 2 + 1);
+            cout << "\nError: Packed patterns have " << h.nInputs << " inputs, but the circuit has " << I << "!!\n";
+            cout << "0 patterns simulated.\n";
+            return;
         }
-        fecPairs.push(v);
+        packed = (const SimWord*)(p + sizeof(h));   // 8-byte aligned
+        nPacked = h.nPatterns;
     }
+    initFECPairs();
+    beginSimLog();
     
-    string pattern;
+    SimPool pool(nThreads);
+    vector<SimWord> block(I), words(I * simWords);
+    string blocks;
     size_t cnt = 0;
-    size_t digit = 0;
-    for(size_t i = 0; i < _aigList.size(); ++i)
-        _aigList[i]->_simResults = 0;
-    string resStr = "";
-    for(size_t i = 0; i < I; ++i)
-        resStr += "0";
-    while(true)
+    bool error = false;
+    while(!error)
     {
-        if(!patternFile.eof()) patternFile >> pattern;
-        if(patternFile.eof() | !pattern.size())
+        // up to simWords blocks of 64 patterns for one pass
+        size_t n = 0, got = 64;
+        fill(words.begin(), words.end(), 0);
+        for(size_t j = 0; j < simWords && got == 64 && !error; ++j)
         {
-            if(digit == 0)  break;
-            else
+            if(packed)
             {
-                pattern = resStr;
-                cnt--;
+                size_t at = cnt + n;
+                got = nPacked - at < 64 ? nPacked - at : 64;
+                if(got) copy(packed + at / 64 * I, packed + at / 64 * I + I, block.begin());
             }
+            else got = parsePatterns(p, end, I, block, error);
+            if(!got) break;
+            // the unused bits stand for all-0 patterns, which fill up the
+            // last word; they are not counted
+            if(got < 64)
+                for(size_t i = 0; i < I; ++i)
+                    block[i] &= (SimWord(1) << got) - 1;
+            if(_patOut) blocks.append((const char*)block.data(), I * sizeof(SimWord));
+            for(size_t i = 0; i < I; ++i)
+                words[i * simWords + j] = block[i];
+            n += got;
         }
-        if(pattern.size() != I)
-        {
-            cout << "\nError: Pattern(" << pattern << ") length(" << pattern.size() << ") does not match the number of inputs(" << I << ") in a circuit!!\n";
-            cnt = 0;
-            break;
-        }
-        if(pattern.find_first_not_of("01") != string::npos)
-        {
-            cout << "\nError: Pattern(" << pattern << ") contains a non-0/1 character('" << pattern[pattern.find_first_not_of("01")] << "').\n";
-            cnt = 0;
-            break;
-        }
-        simulate(pattern);
-        for(size_t j = 0; j < A; ++j)
-            if(_aigList[j]->_sim)
-                _aigList[j]->_simResults += (1 << digit);
-        cnt++;
-        digit++;
-//        cout << pattern << "!" << cnt << "\n";
-        if(digit == 16)
+        if(!n) break;
+        simulate(_simVal, words, &pool);
+        cnt += n;
+        for(size_t j = 0; j * 64 < n; ++j)
         {
-            genFECPairs();
-            updateValue();
-//            for(size_t i = 0; i < A; ++i)
-//                cout << toBinary(_aigList[i]->_simResults, 16) << endl;
-            for(size_t i = 0; i < A; ++i)
-                _aigList[i]->_simResults = 0;
-            digit = 0;
+            size_t m = n - j * 64 < 64 ? n - j * 64 : 64;
+            if(error && m < 64) break;  // a broken file ends mid-word
+            logPatterns(_simVal, j, 0, m);
+            genFECPairs(_simVal, j, ~SimWord(0));
+            updateValue(_simVal, j, m);
         }
-        if((digit == 0) & (patternFile.eof())) break;
     }
-//    for(size_t i = 0; i < A; ++i)
-//        cout << toBinary(_aigList[i]->_simResults, 16) << endl;
-//    genFECPairs();
-    //        cerr << noNewPairGen << endl;
-    if(fecPairs.front()->size() == (_aigList.size() + 1) * 2) fecPairs.pop();
+    if(error) cnt = 0;
+    else if(_patOut) writePatterns(*_patOut, I, blocks, cnt);
+    if(!_fecClasses.empty() && _fecClasses.classSize(0) == (_aigList.size() + 1) * 2)
+        _fecClasses.clear();
+    endSimLog();
     cout << cnt << " patterns simulated.\n";
 }
 
@@ -231,141 +522,265 @@ CirMgr::fileSim(ifstream& patternFile)
 /*   Private member functions about Simulation   */
 /*************************************************/
 
+// Put the PI words into "val" (words[i * simWords + j] is word j of PI i)
+// and propagate them level by level, one SimBlock per gate: the AIG
+// buckets go to the SIMD kernel, then the POs. Only "val" is written.
+// With a pool of nThreads > 1 every bucket is cut into contiguous chunks,
+// one per thread, and all wait at a barrier before the next one. A gate's block is
+// a cache line of its own, so the threads never write to a shared line.
 void
-CirMgr::simulate(string& pattern)
+CirMgr::simulate(CirSimBuf& val, const vector<SimWord>& words, SimPool* pool) const
 {
-    const0->_sim = false;
+    const unsigned nThreads = (pool ? pool->size() : 1);
     for(size_t i = 0; i < I; ++i)
-        _piList[i]->_sim = (pattern[i] == '1');
-    
-//    string results = "";
-//    for(size_t i = 0; i < O; ++i)
-//        results += "0";
-    
-    CirGate::_globalRef++;
-    for(size_t i = 0; i < O; ++i)
-        _poList[i]->simulateByDFS();
-    
-//    return toDecimal(results);
+        for(size_t j = 0; j < simWords; ++j)
+            val[_piList[i]->_gateID].w[j] = words[i * simWords + j];
+    val[0] = SimBlock();
+    const size_t poBucket = _levelStart.size() - 2;
+    if(nThreads == 1)
+    {
+        simKernel(val.data(), _levelOrder.data() + _levelStart[1],
+                  _levelStart[poBucket] - _levelStart[1], _fanin0Lit.data(), _fanin1Lit.data());
+        simPOs(val.data(), _levelOrder.data() + _levelStart[poBucket],
+               _levelStart[poBucket + 1] - _levelStart[poBucket], _fanin0Lit.data());
+        return;
+    }
+    SimBarrier barrier(nThreads);
+    auto work = [&](unsigned t) {
+        for(size_t l = 1; l <= poBucket; ++l)
+        {
+            // small buckets go to fewer threads
+            size_t lo = _levelStart[l], n = _levelStart[l + 1] - lo;
+            size_t chunk = (n + nThreads - 1) / nThreads;
+            if(chunk < simChunkMin) chunk = simChunkMin;
+            size_t b = t * chunk < n ? t * chunk : n;
+            size_t e = b + chunk < n ? b + chunk : n;
+            if(l == poBucket)
+            {
+                simPOs(val.data(), _levelOrder.data() + lo + b, e - b, _fanin0Lit.data());
+                break;
+            }
+            simKernel(val.data(), _levelOrder.data() + lo + b, e - b,
+                      _fanin0Lit.data(), _fanin1Lit.data());
+            barrier.wait();
+        }
+    };
+    pool->run(work);
 }
 
+// Event-driven update of "val" after a local change: the PIs in "changed"
+// got new words, the other gates new fanins. Their fanout cones are
+// re-evaluated in level order, and a gate that comes out with the same
+// block does not wake its fanouts. As in simulate(), only the gates of
+// _dfsList are evaluated. The levels may be stale in the middle of a pass
+// of merges; that only costs an extra evaluation, since a gate is queued
+// again whenever a fanin changes after it was evaluated.
 void
-CirMgr::genFECPairs()
+CirMgr::resimulate(CirSimBuf& val, const vector<unsigned>& changed)
 {
-    unordered_map<size_t, vector<unsigned>*> m1;
-//    unordered_map<unsigned, size_t> m2;
-    size_t n = fecPairs.size();
-    
-    vector<unsigned>* v;
-    for(size_t i = 0; i < n; ++i)
+    typedef pair<unsigned, unsigned> SimEvent;      // (level, gate ID)
+    priority_queue<SimEvent, vector<SimEvent>, greater<SimEvent> > events;
+    auto wake = [&](unsigned id) {
+        if(_simQueued[id] || !inDFSList(id)) return;
+        _simQueued[id] = 1;
+        events.push(SimEvent(_level[id], id));
+    };
+    auto wakeFanouts = [&](unsigned id) {
+        for(size_t i = 0; i < getFanoutNum(id); ++i)
+            wake(getFanout(id, i));
+    };
+    for(size_t i = 0; i < changed.size(); ++i)
+    {
+        if(_gateType[changed[i]] == PI_GATE) wakeFanouts(changed[i]);
+        else wake(changed[i]);
+    }
+    while(!events.empty())
     {
-        v = fecPairs.front();
-        fecPairs.pop();
-//        if((*v)[0] / 2 == (*fecPairs.front())[0] / 2) fecPairs.pop();
-        m1.clear();
-        for(size_t j = 0; j < v->size(); ++j)
+        unsigned id = events.top().second;
+        events.pop();
+        _simQueued[id] = 0;
+        SimBlock old = val[id];
+        if(_gateType[id] == AIG_GATE)
+            simKernel(val.data(), &id, 1, _fanin0Lit.data(), _fanin1Lit.data());
+        else
+            simPOs(val.data(), &id, 1, _fanin0Lit.data());
+        if(memcmp(&old, &val[id], sizeof(SimBlock)) != 0) wakeFanouts(id);
+    }
+}
+
+// The PI words of random block "block"; see randomSim(). Whole words come
+// from the block's generator, and the lanes still owed to the SAT models
+// are then masked in from _satWords.
+void
+CirMgr::randomBlock(size_t block, unsigned seed, vector<SimWord>& words) const
+{
+    SimRng rng((SimWord(seed) << 32) ^ block);
+    for(size_t k = 0; k < words.size(); ++k) words[k] = rng();
+    for(size_t j = 0, w = block * simWords; j < simWords && w * 64 < _satCnt; ++j, ++w)
+    {
+        size_t left = _satCnt - w * 64;
+        SimWord mask = (left < 64 ? (SimWord(1) << left) - 1 : ~SimWord(0));
+        for(size_t i = 0; i < I; ++i)
         {
-//            cout << (*v)[j] << " " << getResults((*v)[j]) << endl;
-            if(!m1[getResults((*v)[j])])
-            {
-                if(m1[(1 << 16) - 1 - getResults((*v)[j])]) continue;
-                m1[getResults((*v)[j])] = new vector<unsigned>;
-                m1[getResults((*v)[j])]->push_back((*v)[j]);
-                fecPairs.push(m1[getResults((*v)[j])]);
-            }
-            else
-            {
-                m1[getResults((*v)[j])]->push_back((*v)[j]);
-//                for(size_t k = 0; k < m1[getResults((*v)[j])]->size(); ++k)
-//                    cout << (*m1[getResults((*v)[j])])[k] << " ";
-//                cout << endl;
-            }
-            getGate((*v)[j] / 2)->_fecGroup = m1[getResults((*v)[j])];
-            getGate((*v)[j] / 2)->_invFec = ((*v)[j] % 2 == 1);
+            SimWord& x = words[i * simWords + j];
+            x = (x & ~mask) | (_satWords[w * I + i] & mask);
         }
-        deleteDupVec();
-        deleteSingle();
     }
 }
 
-size_t
-CirMgr::getResults(unsigned n)
+// The first round starts from one class holding const 0 and every AIG
+void
+CirMgr::initFECPairs()
 {
-    bool inverse = false;
-    if(n % 2 == 1) inverse = true;
-    n = n / 2;
-    size_t t = getGate(n)->_simResults;
-    if(inverse) t = (1 << 16) - 1 - t;
-    return t;
+    if(!_fecClasses.empty()) return;
+    vector<unsigned> v;
+    v.push_back(0);
+    v.push_back(1);
+    for(size_t i = 0; i < _topoOrder.size(); ++i)
+    {
+        if(_gateType[_topoOrder[i]] != AIG_GATE) continue;
+        v.push_back(_topoOrder[i] * 2);
+        v.push_back(_topoOrder[i] * 2 + 1);
+    }
+    _fecClasses.reset(_gateList.size());
+    _fecClasses.addClass(v.data(), v.data() + v.size());
 }
 
+// The log is kept in _logBuf and written out in large chunks.  A binary
+// log starts with a header whose pattern count is filled in at the end.
 void
-CirMgr::deleteDupVec()
+CirMgr::beginSimLog()
 {
-    size_t n = fecPairs.size();
-    unordered_map<size_t, int*> m;
-    vector<unsigned>* v;
-    for(size_t i = 0; i < n; ++i)
+    _logBuf.clear();
+    _logCnt = 0;
+    if(!_simLog || !_logBinary) return;
+    _logBlock.assign(I + O, 0);
+    CirLogHeader h;
+    memset(&h, 0, sizeof(h));
+    _logBuf.append((const char*)&h, sizeof(h));
+}
+
+// Log the n patterns at bits sh .. sh + n - 1 of word j of the PI/PO
+// blocks in "val". A binary log takes them a word at a time into the open
+// 64-pattern block, spilling into the next one.
+void
+CirMgr::logPatterns(const CirSimBuf& val, size_t j, size_t sh, size_t n)
+{
+    if(!_simLog || !n) return;
+    const SimWord mask = (n == 64 ? ~SimWord(0) : (SimWord(1) << n) - 1);
+    auto word = [&](size_t i) {
+        unsigned id = (i < I ? _piList[i] : _poList[i - I])->_gateID;
+        return (val[id].w[j] >> sh) & mask;
+    };
+    if(_logBinary)
     {
-        v = fecPairs.front();
-        fecPairs.pop();
-        if(!m[(*v)[0] / 2])
+        size_t b = _logCnt % 64;
+        if(b == 0 && _logCnt)
         {
-            m[(*v)[0] / 2] = new int;
-            fecPairs.push(v);
+            _logBuf.append((const char*)_logBlock.data(), (I + O) * sizeof(SimWord));
+            fill(_logBlock.begin(), _logBlock.end(), 0);
         }
+        for(size_t i = 0; i < I + O; ++i)
+            _logBlock[i] |= word(i) << b;
+        if(b + n > 64)
+        {
+            _logBuf.append((const char*)_logBlock.data(), (I + O) * sizeof(SimWord));
+            for(size_t i = 0; i < I + O; ++i)
+                _logBlock[i] = word(i) >> (64 - b);
+        }
+        _logCnt += n;
+    }
+    else
+    {
+        vector<SimWord> words(I + O);
+        for(size_t i = 0; i < I + O; ++i)
+            words[i] = word(i);
+        size_t pos = _logBuf.size();
+        _logBuf.resize(pos + n * (I + O + 2));
+        char* p = &_logBuf[pos];
+        for(size_t k = 0; k < n; ++k)
+        {
+            for(size_t i = 0; i < I; ++i)
+                *p++ = '0' + ((words[i] >> k) & 1);
+            *p++ = ' ';
+            for(size_t i = I; i < I + O; ++i)
+                *p++ = '0' + ((words[i] >> k) & 1);
+            *p++ = '\n';
+        }
+        _logCnt += n;
+    }
+    if(_logBuf.size() >= logFlushSize)
+    {
+        _simLog->write(_logBuf.data(), _logBuf.size());
+        _logBuf.clear();
     }
 }
 
 void
-CirMgr::deleteSingle()
+CirMgr::endSimLog()
 {
-    size_t n = fecPairs.size();
-    vector<unsigned>* v;
-    for(size_t i = 0; i < n; ++i)
+    if(!_simLog) return;
+    if(_logBinary && _logCnt)
+        _logBuf.append((const char*)_logBlock.data(), (I + O) * sizeof(SimWord));
+    _simLog->write(_logBuf.data(), _logBuf.size());
+    _logBuf.clear();
+    if(_logBinary)
     {
-        v = fecPairs.front();
-        fecPairs.pop();
-        if(v->size() > 1)
-            fecPairs.push(v);
+        CirLogHeader h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, cirLogMagic, sizeof(h.magic));
+        h.version = cirLogVersion;
+        h.nInputs = I;
+        h.nOutputs = O;
+        h.nPatterns = _logCnt;
+        _simLog->seekp(0);
+        _simLog->write((const char*)&h, sizeof(h));
+        _simLog->seekp(0, ios::end);
     }
+    _simLog->flush();
 }
 
+// Word j of the signatures in "val", masked to the patterns that count,
+// splits the classes
 void
-CirMgr::updateValue()
+CirMgr::genFECPairs(const CirSimBuf& val, size_t j, SimWord mask)
 {
-    string v1, v2;
-    for(size_t i = 0; i < _aigList.size(); ++i)
+    _fecClasses.refine([&](unsigned lit) {
+        SimWord w = val[litID(lit)].w[j];
+        return litInv(lit) ? ~w : w;
+    }, mask);
+}
+
+// Candidate pairs sum n(n-1)/2 over the FEC classes of n gates each
+void
+CirMgr::fecStats(size_t& classes, size_t& pairs, size_t& largest) const
+{
+    classes = pairs = largest = 0;
+    for(unsigned c = 0; c < _fecClasses.size(); ++c)
     {
-        v1 = toBinary(_aigList[i]->_simResults, 16);
-        v2 = v1.substr(8);
-        v1 = v1.substr(0, 8);
-//        cout << v1 << " " << v2 << endl;
-        _aigList[i]->_value.push(v1);
-        _aigList[i]->_value.push(v2);
-        _aigList[i]->_value.pop();
-        _aigList[i]->_value.pop();
+        size_t n = _fecClasses.classSize(c);
+        ++classes;
+        pairs += n * (n - 1) / 2;
+        if(n > largest) largest = n;
     }
+}
+
+// Shift the n patterns of word j of "val" into the 64-pattern history, 16
+// at a time as CIRGate has always shown it: each group goes in at the low
+// end, its first pattern lowest, so a short history stays right-aligned.
+// A last group under 16 is filled up by the all-0 patterns of the word.
+void
+CirMgr::updateValue(const CirSimBuf& val, size_t j, size_t n)
+{
+    auto shiftIn = [&](CirGate* g) {
+        SimWord w = val[g->_gateID].w[j], &v = _value[g->_gateID];
+        for(size_t b = 0; b < n; b += 16)
+            v = (v << 16) | ((w >> b) & 0xffff);
+    };
+    for(size_t i = 0; i < _aigList.size(); ++i)
+        if(_aigList[i]) shiftIn(_aigList[i]);
     for(size_t i = 0; i < _piList.size(); ++i)
-    {
-        v1 = toBinary(_piList[i]->_simResults, 16);
-        v2 = v1.substr(8);
-        v1 = v1.substr(0, 8);
-//        cout << v1 << " " << v2 << endl;
-        _piList[i]->_value.push(v1);
-        _piList[i]->_value.push(v2);
-        _piList[i]->_value.pop();
-        _piList[i]->_value.pop();
-    }
+        shiftIn(_piList[i]);
     for(size_t i = 0; i < _poList.size(); ++i)
-    {
-        v1 = toBinary(_poList[i]->_simResults, 16);
-        v2 = v1.substr(8);
-        v1 = v1.substr(0, 8);
-//        cout << v1 << " " << v2 << endl;
-        _poList[i]->_value.push(v1);
-        _poList[i]->_value.push(v2);
-        _poList[i]->_value.pop();
-        _poList[i]->_value.pop();
-    }
+        shiftIn(_poList[i]);
 }
@@ -1,3 +1,4 @@
 main.o: main.cpp ../../include/util.h ../../include/rnGen.h \
- ../../include/myUsage.h ../../include/cmdParser.h \
+ ../../include/myUsage.h ../../include/myArena.h \
+ ../../include/cmdParser.h \
  ../../include/cmdCharDef.h
@@ -1,3 +1,3 @@
 myGetChar.o: myGetChar.cpp
 myString.o: myString.cpp
-util.o: util.cpp rnGen.h myUsage.h
+util.o: util.cpp rnGen.h myUsage.h myArena.h
@@ -0,0 +1,78 @@
+/****************************************************************************
+  FileName     [ myArena.h ]
+  PackageName  [ util ]
+  Synopsis     [ Bump allocator releasing all its objects at once ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2007-present LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+#ifndef MY_ARENA_H
+#define MY_ARENA_H
+
+#include <vector>
+#include <new>
+
+using namespace std;
+
+//----------------------------------------------------------------------
+//    MyArena: objects placed back to back in large blocks
+//----------------------------------------------------------------------
+// alloc() hands out 8-byte aligned memory in allocation order; there is no
+// per-object free. reset() returns all the blocks at once, so destructors
+// (if any are needed) must be run by the owner before that.
+//
+class MyArena
+{
+public:
+   MyArena(size_t blockSize = 1 << 20)
+   : _blockSize(blockSize), _cur(0), _end(0), _used(0), _reserved(0) {}
+   ~MyArena() { reset(); }
+
+   void* alloc(size_t n) {
+      n = (n + 7) & ~size_t(7);
+      if (size_t(_end - _cur) < n) newBlock(n);
+      void* p = _cur;
+      _cur += n;
+      _used += n;
+      totalUsed() += n;
+      return p;
+   }
+   void reset() {
+      for (size_t i = 0, n = _blocks.size(); i < n; ++i)
+         ::operator delete(_blocks[i]);
+      _blocks.clear();
+      totalUsed() -= _used;
+      totalReserved() -= _reserved;
+      _cur = _end = 0;
+      _used = _reserved = 0;
+   }
+
+   size_t usedBytes() const { return _used; }
+   size_t reservedBytes() const { return _reserved; }
+   size_t numBlocks() const { return _blocks.size(); }
+
+   // over all the arenas; reported by MyUsage
+   static size_t& totalUsed() { static size_t n = 0; return n; }
+   static size_t& totalReserved() { static size_t n = 0; return n; }
+
+private:
+   size_t          _blockSize;
+   vector<char*>   _blocks;
+   char*           _cur;
+   char*           _end;
+   size_t          _used;
+   size_t          _reserved;
+
+   void newBlock(size_t n) {
+      size_t size = (n > _blockSize ? n : _blockSize);
+      _cur = (char*)::operator new(size);
+      _end = _cur + size;
+      _blocks.push_back(_cur);
+      _reserved += size;
+      totalReserved() += size;
+   }
+
+   MyArena(const MyArena&);                 // non-copyable
+   MyArena& operator = (const MyArena&);
+};
+
+#endif // MY_ARENA_H
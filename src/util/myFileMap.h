@@ -0,0 +1,64 @@
+/****************************************************************************
+  FileName     [ myFileMap.h ]
+  PackageName  [ util ]
+  Synopsis     [ Read-only memory mapping of a whole file ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2007-present LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+#ifndef MY_FILE_MAP_H
+#define MY_FILE_MAP_H
+
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+//----------------------------------------------------------------------
+//    MyFileMap: the whole file as one read-only [begin(), end()) range
+//----------------------------------------------------------------------
+// The mapping is released by close() or the destructor; pointers into the
+// range must not outlive it.
+//
+class MyFileMap
+{
+public:
+   MyFileMap() : _data(0), _size(0) {}
+   ~MyFileMap() { close(); }
+
+   bool open(const string& fileName) {
+      close();
+      int fd = ::open(fileName.c_str(), O_RDONLY);
+      if (fd < 0) return false;
+      struct stat st;
+      if (fstat(fd, &st) != 0) { ::close(fd); return false; }
+      _size = st.st_size;
+      if (_size) {
+         void* p = mmap(0, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+         if (p == MAP_FAILED) { ::close(fd); _size = 0; return false; }
+         _data = (const char*)p;
+         madvise(p, _size, MADV_SEQUENTIAL);
+      }
+      ::close(fd);  // the mapping stays valid after close
+      return true;
+   }
+   void close() {
+      if (_data) munmap((void*)_data, _size);
+      _data = 0; _size = 0;
+   }
+
+   const char* begin() const { return _data; }
+   const char* end() const { return _data + _size; }
+   size_t size() const { return _size; }
+
+private:
+   const char*  _data;
+   size_t       _size;
+
+   MyFileMap(const MyFileMap&);             // non-copyable
+   MyFileMap& operator = (const MyFileMap&);
+};
+
+#endif // MY_FILE_MAP_H
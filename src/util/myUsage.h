@@ -14,6 +14,7 @@
 #include <iomanip>
 #include <sys/times.h>
 #include <sys/resource.h>
+#include "myArena.h"
 
 using namespace std;
 
@@ -45,6 +46,11 @@ public:
          setMemUsage();
          cout << "Total memory used: " << setprecision(4)
               << _currentMem << " M Bytes" << endl;
+         if (MyArena::totalReserved())
+            cout << "Arena memory used: " << setprecision(4)
+                 << MyArena::totalUsed() / double(1 << 20) << " / "
+                 << MyArena::totalReserved() / double(1 << 20)
+                 << " M Bytes" << endl;
       }
    }
 